@@ -15,6 +15,79 @@ let __rootViewInstance: ViewInstance | null = null;
 let __viewRegistry: Map<string, Instance> = new Map<string, Instance>();
 let __lastMouseDownViewId: string | null = null;
 
+// Mutation opcodes understood by the native `applyMutations` binding. These
+// must be kept in sync with ViewManager::MutationType.
+const MutationType = {
+  CreateView: 0,
+  CreateTextView: 1,
+  InsertChild: 2,
+  RemoveChild: 3,
+  SetProperty: 4,
+  SetRawTextValue: 5,
+};
+
+// Rather than crossing the native bridge for every mutation, we collect each
+// mutation into a flat buffer of opcodes and arguments and apply the whole
+// buffer in a single native call at the end of the commit. Instances created
+// since the last flush have no native ViewId yet, so they carry a negative
+// placeholder id until the flush resolves it.
+let __mutationQueue: any[] = [];
+let __pendingInstances: (Instance | null)[] = [];
+
+function __enqueueMutation(...args: any[]): void {
+  for (let i = 0; i < args.length; ++i) __mutationQueue.push(args[i]);
+}
+
+function __enqueueCreate(
+  mutationType: number,
+  arg: string,
+  instance: Instance
+): string {
+  __enqueueMutation(mutationType, arg);
+  __pendingInstances.push(instance);
+
+  //@ts-ignore
+  return -__pendingInstances.length;
+}
+
+function __flushMutations(): void {
+  if (__mutationQueue.length === 0) return;
+
+  const mutations = __mutationQueue;
+  const pending = __pendingInstances;
+
+  __mutationQueue = [];
+  __pendingInstances = [];
+
+  //@ts-ignore
+  const createdIds = NativeMethods.applyMutations(mutations);
+
+  for (let i = 0; i < pending.length; ++i) {
+    const instance = pending[i];
+
+    // Instances removed again within the batch are left out of the registry
+    if (instance === null) continue;
+
+    //@ts-ignore
+    instance._id = createdIds[i];
+    __viewRegistry.set(createdIds[i], instance);
+  }
+}
+
+function __unregisterSubtree(instance: Instance): void {
+  const id: any = instance._id;
+
+  // An instance created since the last flush has no native id yet, so we drop
+  // it from the pending list instead, which keeps the flush from registering it.
+  if (id < 0) __pendingInstances[-id - 1] = null;
+  else __viewRegistry.delete(id);
+
+  if (instance instanceof ViewInstance) {
+    for (let i = 0; i < instance._children.length; ++i)
+      __unregisterSubtree(instance._children[i]);
+  }
+}
+
 // get any css properties not beginning with a "-",
 // and build a map from any camelCase versions to
 // the hyphenated version
@@ -23,7 +96,7 @@ const cssPropsMap = allCssProps
   .reduce((acc, v) => Object.assign(acc, { [camelCase(v)]: v }), {});
 
 export class ViewInstance {
-  private _id: string;
+  public _id: string;
   private _type: string;
   public _children: Instance[];
   public _props: any = null;
@@ -69,8 +142,12 @@ export class ViewInstance {
 
     this._children.push(childInstance);
 
-    //@ts-ignore
-    return NativeMethods.insertChild(this._id, childInstance._id, -1);
+    __enqueueMutation(
+      MutationType.InsertChild,
+      this._id,
+      childInstance._id,
+      -1
+    );
   }
 
   insertChild(childInstance: Instance, index: number): any {
@@ -78,8 +155,12 @@ export class ViewInstance {
 
     this._children.splice(index, 0, childInstance);
 
-    //@ts-ignore
-    return NativeMethods.insertChild(this._id, childInstance._id, index);
+    __enqueueMutation(
+      MutationType.InsertChild,
+      this._id,
+      childInstance._id,
+      index
+    );
   }
 
   removeChild(childInstance: Instance): any {
@@ -88,10 +169,9 @@ export class ViewInstance {
     if (index >= 0) {
       this._children.splice(index, 1);
 
-      __viewRegistry.delete(childInstance.getViewId());
+      __unregisterSubtree(childInstance);
 
-      //@ts-ignore
-      return NativeMethods.removeChild(this._id, childInstance._id);
+      __enqueueMutation(MutationType.RemoveChild, this._id, childInstance._id);
     }
   }
 
@@ -129,6 +209,10 @@ export class ViewInstance {
           }
 
           return function (...args) {
+            // Make sure the native view reflects every mutation made so far
+            // before calling into it.
+            __flushMutations();
+
             //@ts-ignore
             return NativeMethods.invokeViewMethod(target._id, prop, ...args);
           };
@@ -141,11 +225,12 @@ export class ViewInstance {
     if (macroPropertyGetters.hasOwnProperty(propKey)) {
       //@ts-ignore
       for (const [k, v] of macroPropertyGetters[propKey](value))
-        NativeMethods.setViewProperty(this._id, k, v);
+        __enqueueMutation(MutationType.SetProperty, this._id, k, v);
       return;
     }
-    //@ts-ignore
-    return NativeMethods.setViewProperty(
+
+    __enqueueMutation(
+      MutationType.SetProperty,
       this._id,
       propKey,
       nativeValue ? nativeValue : value
@@ -170,7 +255,7 @@ export class ViewInstance {
 }
 
 export class RawTextViewInstance {
-  private _id: string;
+  public _id: string;
   private _text: string;
   public _parent: ViewInstance;
 
@@ -190,8 +275,7 @@ export class RawTextViewInstance {
 
   setTextValue(text: string): any {
     this._text = text;
-    //@ts-ignore
-    return NativeMethods.setRawTextValue(this._id, text);
+    __enqueueMutation(MutationType.SetRawTextValue, this._id, text);
   }
 }
 
@@ -237,19 +321,16 @@ NativeMethods.dispatchViewEvent = function dispatchEvent(
   eventType: string,
   event: any
 ) {
-  if (__viewRegistry.hasOwnProperty(viewId)) {
-    const instance = __viewRegistry[viewId];
+  const instance = __viewRegistry.get(viewId);
 
+  if (instance !== undefined) {
     // Convert target/relatedTarget to concrete ViewInstance refs
-    if (event.target && __viewRegistry.hasOwnProperty(event.target)) {
-      event.target = __viewRegistry[event.target];
+    if (event.target && __viewRegistry.has(event.target)) {
+      event.target = __viewRegistry.get(event.target);
     }
 
-    if (
-      event.relatedTarget &&
-      __viewRegistry.hasOwnProperty(event.relatedTarget)
-    ) {
-      event.relatedTarget = __viewRegistry[event.relatedTarget];
+    if (event.relatedTarget && __viewRegistry.has(event.relatedTarget)) {
+      event.relatedTarget = __viewRegistry.get(event.relatedTarget);
     }
 
     // Convert native event object into it's SyntheticEvent equivalent if required.
@@ -289,22 +370,24 @@ export default {
     props: any,
     parentInstance: ViewInstance
   ): ViewInstance {
-    //@ts-ignore
-    const id = NativeMethods.createViewInstance(viewType);
-    const instance = new ViewInstance(id, viewType, props, parentInstance);
+    const instance = new ViewInstance("", viewType, props, parentInstance);
+    instance._id = __enqueueCreate(MutationType.CreateView, viewType, instance);
 
-    __viewRegistry[id] = instance;
     return instance;
   },
   createTextViewInstance(text: string, parentInstance: ViewInstance) {
-    //@ts-ignore
-    const id = NativeMethods.createTextViewInstance(text);
-    const instance = new RawTextViewInstance(id, text, parentInstance);
+    const instance = new RawTextViewInstance("", text, parentInstance);
+    instance._id = __enqueueCreate(
+      MutationType.CreateTextView,
+      text,
+      instance
+    );
 
-    __viewRegistry[id] = instance;
     return instance;
   },
   resetAfterCommit() {
+    __flushMutations();
+
     //@ts-ignore
     return NativeMethods.resetAfterCommit();
   },
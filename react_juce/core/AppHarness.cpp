@@ -46,6 +46,9 @@ namespace reactjuce
         {
             sourceFileTypeMap[f.getFullPathName()] = true;
             fileWatcher->watch(f);
+
+            // The file is rebuilt while the app runs it, so it mustn't be mapped
+            EcmascriptEngine::setBytecodeFileMayChange(f);
         }
     }
 
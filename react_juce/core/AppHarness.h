@@ -41,6 +41,12 @@ namespace reactjuce
         void watch (const juce::File& f);
         void watch (const std::vector<juce::File>& fs);
 
+        /** Add a precompiled bytecode file to be watched/managed by the AppHarness.
+         *
+         *  With Duktape, bytecode files are produced from a JS bundle by the
+         *  `reactjuce_duktape_precompiler` tool, see `reactjuce_add_duktape_bytecode`
+         *  in the top level CMakeLists.txt. With Hermes, use the `hermesc` compiler.
+         */
         void watchBytecode (const juce::File& f);
         void watchBytecode (const std::vector<juce::File>& fs);
 
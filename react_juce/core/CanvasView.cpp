@@ -592,8 +592,7 @@ namespace reactjuce
 
     CanvasView::~CanvasView()
     {
-        if (isTimerRunning())
-            stopTimer();
+        setWantsFrameCallbacks(false);
     }
 
     //==============================================================================
@@ -603,13 +602,7 @@ namespace reactjuce
 
         if (name == animateProp)
         {
-            bool shouldAnimate = value;
-
-            if (shouldAnimate && !isTimerRunning())
-                startTimerHz(45);
-
-            if (!shouldAnimate && isTimerRunning())
-                stopTimer();
+            setWantsFrameCallbacks(value);
         }
         
         if (name == statefulProp && props[statefulProp])
@@ -619,8 +612,9 @@ namespace reactjuce
     }
 
     //==============================================================================
-    void CanvasView::timerCallback()
+    void CanvasView::frameCallback (double timestampMs)
     {
+        juce::ignoreUnused(timestampMs);
         repaint();
     }
 
@@ -636,6 +630,11 @@ namespace reactjuce
             const auto drawCommands = std::invoke( props[onDrawProp].getNativeFunction()
                                                  , juce::var::NativeFunctionArgs(juce::var(), nullptr, 0u));
 
+            // With the engine on a thread of its own, onDraw runs there without
+            // returning anything to us
+            if (!drawCommands.isArray())
+                return;
+
             if (props.contains(statefulProp) && props[statefulProp])
             {
                 juce::Graphics imageGraphics(canvasImage);
@@ -20,7 +20,7 @@ namespace reactjuce
      * JS CanvasRenderingContext calls are handled here and converted to JUCE graphics
      * routines.
      */
-    class CanvasView : public View, public juce::Timer
+    class CanvasView : public View
     {
     public:
         //==============================================================================
@@ -63,7 +63,8 @@ namespace reactjuce
         void setProperty (const juce::Identifier& name, const juce::var& value) override;
 
         //==============================================================================
-        void timerCallback() override;
+        /** Repaints on every frame of the root's frame clock while animating. */
+        void frameCallback (double timestampMs) override;
 
         //==============================================================================
         void paint (juce::Graphics& g) override;
@@ -8,9 +8,14 @@
 */
 
 #include "EcmascriptEngine.h"
+#include "TimerQueue.h"
+#include "ProfileRecorder.h"
+#include "ExecutionBudget.h"
 
 #if REACTJUCE_USE_HERMES
     #include "EcmascriptEngine_Hermes.cpp"
+#elif REACTJUCE_USE_QUICKJS
+    #include "EcmascriptEngine_QuickJS.cpp"
 #elif REACTJUCE_USE_DUKTAPE
     #include "EcmascriptEngine_Duktape.cpp"
 #endif
@@ -19,9 +24,113 @@
 namespace reactjuce
 {
 
+    namespace detail
+    {
+        //==============================================================================
+        /** The process-wide cache of compiled bundles, referring to the latest compiled
+         *  form of each file by path for as long as an engine keeps it.
+         *
+         *  It also keeps the bytecode files which have to be read rather than mapped:
+         *  those marked as liable to change, and those seen to have changed.
+         */
+        class CompiledBundleCache
+        {
+        public:
+            static CompiledBundleCache& getInstance()
+            {
+                static CompiledBundleCache instance;
+                return instance;
+            }
+
+            std::shared_ptr<const EcmascriptEngine::CompiledBundle> find (const juce::String& key, juce::uint64 contentHash)
+            {
+                const juce::ScopedLock sl (lock);
+
+                if (auto it = entries.find(key); it != entries.end() && it->second.contentHash == contentHash)
+                    return it->second.compiled.lock();
+
+                return nullptr;
+            }
+
+            void store (const juce::String& key, juce::uint64 contentHash, std::shared_ptr<const EcmascriptEngine::CompiledBundle> compiled)
+            {
+                const juce::ScopedLock sl (lock);
+                entries[key] = { contentHash, std::move(compiled) };
+            }
+
+            void clear()
+            {
+                const juce::ScopedLock sl (lock);
+                entries.clear();
+            }
+
+            //==============================================================================
+            void setMayChange (const juce::String& path, bool mayChange)
+            {
+                const juce::ScopedLock sl (lock);
+
+                if (mayChange)
+                    changeablePaths.insert(path);
+                else
+                    changeablePaths.erase(path);
+            }
+
+            /** Returns true if the bytecode file at the given path should be read rather
+             *  than mapped, remembering it as such if its stamp has changed since the
+             *  last time it was stored.
+             */
+            bool shouldReadBytecode (const juce::String& path, const juce::String& key, juce::uint64 fileStamp)
+            {
+                const juce::ScopedLock sl (lock);
+
+                if (auto it = entries.find(key); it != entries.end() && it->second.contentHash != fileStamp)
+                    changeablePaths.insert(path);
+
+                return changeablePaths.count(path) > 0;
+            }
+
+        private:
+            struct Entry
+            {
+                juce::uint64 contentHash = 0;
+                std::weak_ptr<const EcmascriptEngine::CompiledBundle> compiled;
+            };
+
+            juce::CriticalSection lock;
+            std::unordered_map<juce::String, Entry> entries;
+            std::unordered_set<juce::String> changeablePaths;
+        };
+
+        /** A 64-bit FNV-1a hash of the given data, seeded with its size. */
+        static juce::uint64 hashContents (const juce::MemoryBlock& data)
+        {
+            auto hash = static_cast<juce::uint64>(14695981039346656037ull) ^ static_cast<juce::uint64>(data.getSize());
+            const auto* bytes = static_cast<const juce::uint8*>(data.getData());
+
+            for (size_t i = 0; i < data.getSize(); ++i)
+                hash = (hash ^ bytes[i]) * static_cast<juce::uint64>(1099511628211ull);
+
+            return hash;
+        }
+
+        /** A hash of the size and modification time of the given file, which stands in
+         *  for a hash of the contents of files we'd rather not read in full.
+         */
+        static juce::uint64 hashFileStamp (const juce::File& file)
+        {
+            auto hash = static_cast<juce::uint64>(14695981039346656037ull) ^ static_cast<juce::uint64>(file.getSize());
+            hash = (hash ^ static_cast<juce::uint64>(file.getLastModificationTime().toMilliseconds())) * static_cast<juce::uint64>(1099511628211ull);
+
+            return hash;
+        }
+    }
+
     //==============================================================================
     EcmascriptEngine::EcmascriptEngine()
-        : mPimpl(std::make_unique<Pimpl>())
+        : EcmascriptEngine(AllocatorPolicy::System) {}
+
+    EcmascriptEngine::EcmascriptEngine (AllocatorPolicy policy)
+        : mPimpl(std::make_unique<Pimpl>(policy))
     {
         /** If you hit this, you're probably trying to run a console application.
 
@@ -44,12 +153,116 @@ namespace reactjuce
 
     juce::var EcmascriptEngine::evaluate (const juce::File& code)
     {
-        return mPimpl->evaluate(code);
+        return mPimpl->evaluateCompiled(keepEvaluatedBundle(getCompiledSource(code)));
     }
 
     juce::var EcmascriptEngine::evaluateBytecode (const juce::File &code)
     {
-        return mPimpl->evaluateBytecode(code);
+        return mPimpl->evaluateCompiled(keepEvaluatedBundle(getCompiledBytecode(code)));
+    }
+
+    juce::var EcmascriptEngine::evaluateBytecode (const void* data, size_t size, const juce::String& name)
+    {
+        return mPimpl->evaluateCompiled(keepEvaluatedBundle(getCompiledBytecode(data, size, name)));
+    }
+
+    void EcmascriptEngine::clearCompiledBundleCache()
+    {
+        detail::CompiledBundleCache::getInstance().clear();
+    }
+
+    void EcmascriptEngine::setBytecodeFileMayChange (const juce::File& file, bool mayChange)
+    {
+        detail::CompiledBundleCache::getInstance().setMayChange(file.getFullPathName(), mayChange);
+    }
+
+    const EcmascriptEngine::CompiledBundle& EcmascriptEngine::keepEvaluatedBundle (std::shared_ptr<const CompiledBundle> compiled)
+    {
+        if (std::find(evaluatedBundles.begin(), evaluatedBundles.end(), compiled) == evaluatedBundles.end())
+            evaluatedBundles.push_back(compiled);
+
+        return *compiled;
+    }
+
+    std::shared_ptr<const EcmascriptEngine::CompiledBundle> EcmascriptEngine::getCompiledSource (const juce::File& file)
+    {
+        juce::MemoryBlock data;
+
+        if (!file.loadFileAsData(data) || data.getSize() == 0)
+            throw Error("Failed to read file: " + file.getFullPathName());
+
+        const auto key = "source:" + file.getFullPathName();
+        const auto contentHash = detail::hashContents(data);
+
+        auto& cache = detail::CompiledBundleCache::getInstance();
+
+        if (auto compiled = cache.find(key, contentHash))
+            return compiled;
+
+        auto compiled = mPimpl->compile(file, data);
+        cache.store(key, contentHash, compiled);
+
+        return compiled;
+    }
+
+    std::shared_ptr<const EcmascriptEngine::CompiledBundle> EcmascriptEngine::getCompiledBytecode (const juce::File& file)
+    {
+        if (!file.existsAsFile())
+            throw Error("Failed to read file: " + file.getFullPathName());
+
+        // Hashing the contents would page in the whole of the mapped file, which
+        // is what mapping it is meant to avoid
+        const auto key = "bytecode:" + file.getFullPathName();
+        const auto fileStamp = detail::hashFileStamp(file);
+
+        auto& cache = detail::CompiledBundleCache::getInstance();
+
+        if (auto compiled = cache.find(key, fileStamp))
+            return compiled;
+
+        if (cache.shouldReadBytecode(file.getFullPathName(), key, fileStamp))
+        {
+            auto data = std::make_shared<juce::MemoryBlock>();
+
+            if (!file.loadFileAsData(*data) || data->getSize() == 0)
+                throw Error("Failed to read file: " + file.getFullPathName());
+
+            auto compiled = mPimpl->compileBytecode(file.getFullPathName(), data, data->getData(), data->getSize());
+            cache.store(key, fileStamp, compiled);
+
+            return compiled;
+        }
+
+        auto mappedFile = std::make_shared<juce::MemoryMappedFile>(file, juce::MemoryMappedFile::readOnly);
+
+        if (mappedFile->getData() == nullptr || mappedFile->getSize() == 0)
+            throw Error("Failed to read file: " + file.getFullPathName());
+
+        auto compiled = mPimpl->compileBytecode(file.getFullPathName(), mappedFile, mappedFile->getData(), mappedFile->getSize());
+        cache.store(key, fileStamp, compiled);
+
+        return compiled;
+    }
+
+    std::shared_ptr<const EcmascriptEngine::CompiledBundle> EcmascriptEngine::getCompiledBytecode (const void* data, size_t size, const juce::String& name)
+    {
+        if (data == nullptr || size == 0)
+            throw Error("No bytecode to evaluate: " + name);
+
+        // The data is required to outlive us unchanged, so its address and size
+        // are enough to identify it
+        const auto key = "memory:" + juce::String::toHexString(reinterpret_cast<juce::pointer_sized_int>(data));
+        const auto size64 = static_cast<juce::uint64>(size);
+
+        auto& cache = detail::CompiledBundleCache::getInstance();
+
+        if (auto compiled = cache.find(key, size64))
+            return compiled;
+
+        auto compiled = mPimpl->compileBytecode(name, nullptr, data, size);
+        cache.store(key, size64, compiled);
+
+        return compiled;
     }
 
     //==============================================================================
@@ -74,15 +287,252 @@ namespace reactjuce
         mPimpl->registerNativeProperty(target, name, value);
     }
 
+    void EcmascriptEngine::registerTypedNativeFunction (const juce::String& target, const juce::String& name, int numArgs, TypedNativeFunction fn)
+    {
+        mPimpl->registerTypedNativeFunction(target, name, numArgs, std::move(fn));
+    }
+
     //==============================================================================
     juce::var EcmascriptEngine::invoke (const juce::String& name, const std::vector<juce::var>& vargs)
     {
         return mPimpl->invoke(name, vargs);
     }
 
+    //==============================================================================
+    EcmascriptEngine::FunctionHandle EcmascriptEngine::resolve (const juce::String& name)
+    {
+        return mPimpl->resolve(name);
+    }
+
+    bool EcmascriptEngine::isValid (const FunctionHandle& handle) const
+    {
+        return mPimpl->isValid(handle);
+    }
+
+    juce::var EcmascriptEngine::invoke (const FunctionHandle& handle, const std::vector<juce::var>& vargs)
+    {
+        return mPimpl->invoke(handle, vargs);
+    }
+
+    //==============================================================================
+    void EcmascriptEngine::setCallbackDispatcher (CallbackDispatcher dispatcher)
+    {
+        mPimpl->setCallbackDispatcher(std::move(dispatcher));
+    }
+
     void EcmascriptEngine::reset()
     {
         mPimpl->reset();
+        evaluatedBundles.clear();
+    }
+
+    //==============================================================================
+    EcmascriptEngine::MemoryStats EcmascriptEngine::getMemoryStats() const
+    {
+        return mPimpl->getMemoryStats();
+    }
+
+    EcmascriptEngine::HeapStats EcmascriptEngine::getHeapStats() const
+    {
+        HeapStats stats;
+        stats.memory = getMemoryStats();
+        stats.numCollections = numCollections;
+        stats.lastCollectionMs = lastCollectionMs;
+        stats.totalCollectionMs = totalCollectionMs;
+        return stats;
+    }
+
+    bool EcmascriptEngine::collectGarbage (double budgetMs)
+    {
+        if (expectedCollectionMs > budgetMs)
+        {
+            expectedCollectionMs = expectedCollectionMs * 0.5;
+            return false;
+        }
+
+        const auto start = juce::Time::getMillisecondCounterHiRes();
+        mPimpl->collectGarbage();
+        const auto elapsed = juce::Time::getMillisecondCounterHiRes() - start;
+
+        expectedCollectionMs = elapsed;
+
+        // Collections only run on one thread at a time, so these needn't be
+        // read-modify-write operations
+        numCollections = numCollections + 1;
+        lastCollectionMs = elapsed;
+        totalCollectionMs = totalCollectionMs + elapsed;
+
+        return true;
+    }
+
+    //==============================================================================
+    void EcmascriptEngine::startProfiling (double sampleIntervalMs)
+    {
+        mPimpl->startProfiling(sampleIntervalMs);
+    }
+
+    EcmascriptEngine::Profile EcmascriptEngine::stopProfiling()
+    {
+        return mPimpl->stopProfiling();
+    }
+
+    bool EcmascriptEngine::isProfiling() const
+    {
+        return mPimpl->isProfiling();
+    }
+
+    //==============================================================================
+    void EcmascriptEngine::setExecutionBudget (double budgetMs)
+    {
+        mPimpl->setExecutionBudget(budgetMs);
+    }
+
+    double EcmascriptEngine::getExecutionBudget() const
+    {
+        return mPimpl->getExecutionBudget();
+    }
+
+    EcmascriptEngine::ExecutionStats EcmascriptEngine::getExecutionStats() const
+    {
+        return mPimpl->getExecutionStats();
+    }
+
+    //==============================================================================
+    namespace
+    {
+        juce::String getFrameLabel (const EcmascriptEngine::Profile::Frame& frame)
+        {
+            auto label = frame.functionName.isNotEmpty() ? frame.functionName : juce::String("(anonymous)");
+
+            if (frame.fileName.isNotEmpty())
+                label << " (" << frame.fileName << ":" << frame.lineNumber << ")";
+
+            // Semicolons separate the frames of a collapsed stack
+            return label.replaceCharacter(';', ',');
+        }
+    }
+
+    juce::String EcmascriptEngine::Profile::toCollapsedStacks() const
+    {
+        std::map<juce::String, int> counts;
+
+        for (auto& sample : samples)
+        {
+            juce::String line;
+
+            for (auto index : sample.stack)
+            {
+                if (line.isNotEmpty())
+                    line << ";";
+
+                line << getFrameLabel(frames[static_cast<size_t>(index)]);
+            }
+
+            if (line.isNotEmpty())
+                counts[line]++;
+        }
+
+        juce::String result;
+
+        for (auto& [stack, count] : counts)
+            result << stack << " " << count << "\n";
+
+        return result;
+    }
+
+    juce::String EcmascriptEngine::Profile::toCpuProfile() const
+    {
+        // The format describes a call tree, each node of which is one frame reached
+        // through one particular path from the root, and identifies each sample by
+        // the node at the top of its stack
+        struct Node
+        {
+            int frameIndex;
+            int hitCount = 0;
+            std::vector<int> children;
+        };
+
+        std::vector<Node> nodes { Node { -1 } };
+        std::map<std::pair<int, int>, int> nodeIds;
+
+        juce::Array<juce::var> sampleNodes, timeDeltas;
+        auto lastTimeMs = startTimeMs;
+
+        for (auto& sample : samples)
+        {
+            int node = 0;
+
+            for (auto frameIndex : sample.stack)
+            {
+                auto [it, isNew] = nodeIds.emplace(std::make_pair(node, frameIndex), static_cast<int>(nodes.size()));
+
+                if (isNew)
+                {
+                    nodes[static_cast<size_t>(node)].children.push_back(it->second);
+                    nodes.push_back(Node { frameIndex });
+                }
+
+                node = it->second;
+            }
+
+            nodes[static_cast<size_t>(node)].hitCount++;
+
+            sampleNodes.add(node + 1);
+            timeDeltas.add(juce::roundToInt((sample.timeMs - lastTimeMs) * 1000.0));
+            lastTimeMs = sample.timeMs;
+        }
+
+        std::map<juce::String, int> scriptIds;
+        juce::Array<juce::var> jsonNodes;
+
+        for (size_t i = 0; i < nodes.size(); ++i)
+        {
+            auto& node = nodes[i];
+
+            juce::DynamicObject::Ptr callFrame = new juce::DynamicObject();
+
+            if (node.frameIndex < 0)
+            {
+                callFrame->setProperty("functionName", "(root)");
+                callFrame->setProperty("scriptId", "0");
+                callFrame->setProperty("url", "");
+                callFrame->setProperty("lineNumber", -1);
+                callFrame->setProperty("columnNumber", -1);
+            }
+            else
+            {
+                auto& frame = frames[static_cast<size_t>(node.frameIndex)];
+                auto scriptId = scriptIds.emplace(frame.fileName, static_cast<int>(scriptIds.size()) + 1).first->second;
+
+                callFrame->setProperty("functionName", frame.functionName);
+                callFrame->setProperty("scriptId", juce::String(scriptId));
+                callFrame->setProperty("url", frame.fileName);
+                callFrame->setProperty("lineNumber", frame.lineNumber - 1);
+                callFrame->setProperty("columnNumber", -1);
+            }
+
+            juce::Array<juce::var> children;
+
+            for (auto child : node.children)
+                children.add(child + 1);
+
+            juce::DynamicObject::Ptr jsonNode = new juce::DynamicObject();
+            jsonNode->setProperty("id", static_cast<int>(i) + 1);
+            jsonNode->setProperty("callFrame", callFrame.get());
+            jsonNode->setProperty("hitCount", node.hitCount);
+            jsonNode->setProperty("children", children);
+
+            jsonNodes.add(jsonNode.get());
+        }
+
+        juce::DynamicObject::Ptr profile = new juce::DynamicObject();
+        profile->setProperty("nodes", jsonNodes);
+        profile->setProperty("startTime", static_cast<juce::int64>(startTimeMs * 1000.0));
+        profile->setProperty("endTime", static_cast<juce::int64>(endTimeMs * 1000.0));
+        profile->setProperty("samples", sampleNodes);
+        profile->setProperty("timeDeltas", timeDeltas);
+
+        return juce::JSON::toString(profile.get(), true);
     }
 
     //==============================================================================
@@ -9,7 +9,10 @@
 
 #pragma once
 
+#include <atomic>
+#include <string_view>
 #include <unordered_map>
+#include <unordered_set>
 
 
 namespace reactjuce
@@ -23,8 +26,69 @@ namespace reactjuce
     class EcmascriptEngine
     {
     public:
+        //==============================================================================
+        /** Selects how the engine allocates the memory backing its JavaScript heap. */
+        enum class AllocatorPolicy
+        {
+            /** Every allocation is served by the system allocator. */
+            System,
+
+            /** Small allocations are served from size-class pools owned by the engine,
+             *  while larger ones fall through to the system allocator.
+             */
+            Pooled,
+
+            /** As with `Pooled`, except that the pools are carved out of one growable
+             *  arena per engine, keeping the engine's small objects together rather
+             *  than interleaved with those of every other engine in the process.
+             */
+            PooledArena
+        };
+
+        /** A snapshot of the memory held by the engine's JavaScript heap. */
+        struct MemoryStats
+        {
+            /** The number of bytes currently allocated by the heap. */
+            size_t liveBytes = 0;
+
+            /** The largest value `liveBytes` has reached over the engine's lifetime. */
+            size_t peakBytes = 0;
+
+            /** The number of allocations currently held by the heap. */
+            size_t numLiveAllocations = 0;
+
+            /** The number of allocations made over the engine's lifetime. */
+            size_t numAllocations = 0;
+        };
+
+        /** A snapshot of the engine's heap together with the garbage collections run
+         *  through `collectGarbage`.
+         */
+        struct HeapStats
+        {
+            MemoryStats memory;
+
+            /** The number of collections run through `collectGarbage`. */
+            int numCollections = 0;
+
+            /** The duration of the most recent collection, in milliseconds. */
+            double lastCollectionMs = 0.0;
+
+            /** The total duration of all collections, in milliseconds. */
+            double totalCollectionMs = 0.0;
+        };
+
+        /** The compiled form of a bundle, held in the process-wide cache so that other
+         *  engines can evaluate it without parsing or compiling it again. Its contents
+         *  are specific to the engine backend.
+         *
+         *  Compiled bundles are immutable, and may be shared between engines on any thread.
+         */
+        struct CompiledBundle;
+
         //==============================================================================
         EcmascriptEngine();
+        explicit EcmascriptEngine (AllocatorPolicy policy);
         ~EcmascriptEngine();
 
         //==============================================================================
@@ -58,6 +122,22 @@ namespace reactjuce
                 : std::runtime_error(msg.toStdString()) {}
         };
 
+        //==============================================================================
+        /** A handle to a JavaScript function resolved ahead of time with `resolve`.
+         *
+         *  Invoking through a handle skips the lookup that `invoke` performs on its
+         *  target expression every call, which makes it the better choice for
+         *  functions called at a high rate, such as event dispatchers.
+         *
+         *  Handles are only meaningful to the engine that produced them, and are
+         *  invalidated when that engine is reset.
+         */
+        struct FunctionHandle
+        {
+            int          index      = -1;
+            juce::uint32 generation = 0;
+        };
+
         //==============================================================================
         /** Evaluates the given code in the interpreter, returning the result.
          *
@@ -75,9 +155,48 @@ namespace reactjuce
          * @throws EcmascriptEngine::Error in the event of an evaluation error
          *         or when called on an engine instance which does not support
          *         loading of precompiled bytecode.
+         *
+         * Engines which can run bytecode in place, like Hermes, memory map the file
+         * rather than reading it, so that only the pages which actually execute are
+         * loaded. A file which may be rebuilt while an engine runs it must be marked
+         * with `setBytecodeFileMayChange`, so that it's read into memory instead.
          */
         juce::var evaluateBytecode(const juce::File &code);
 
+        /** Marks a bytecode file as one which may be rewritten while in use, such as a
+         *  bundle rebuilt for hot reloading, or clears that mark.
+         *
+         *  Marked files are read into memory rather than mapped, so that rewriting one
+         *  can't fail for being mapped, nor pull the pages from under an engine that is
+         *  running it. A file whose size or modification time changes between loads
+         *  is read into memory from then on, marked or not. Safe to call from any
+         *  thread.
+         */
+        static void setBytecodeFileMayChange (const juce::File& file, bool mayChange = true);
+
+        /** Evaluates precompiled bytecode from memory, such as a bundle compiled into
+         *  the binary with juce_add_binary_data.
+         *
+         *  The data is used in place where the engine allows, without being copied,
+         *  so it must stay valid and unchanged for the lifetime of the process, as
+         *  BinaryData does. The name identifies the bundle in stack traces.
+         */
+        juce::var evaluateBytecode (const void* data, size_t size, const juce::String& name);
+
+        /** `evaluate` and `evaluateBytecode` take the compiled form of a bundle from a
+         *  cache shared by every engine in the process, so that only the first engine
+         *  to evaluate a given bundle pays for compiling or loading it. Source files are
+         *  keyed by path and a hash of their contents, bytecode files by path, size and
+         *  modification time, so that a changed file replaces its previous entry.
+         *
+         *  The cache only refers to compiled bundles, which are kept by the engines that
+         *  evaluated them until those engines are reset or destroyed. A bundle no engine
+         *  keeps is compiled or loaded again the next time it's evaluated.
+         *
+         *  Clears that cache, so that every bundle is compiled or loaded again.
+         */
+        static void clearCompiledBundleCache();
+
         //==============================================================================
         /** Registers a native method by the given name in the global namespace. */
         void registerNativeMethod (const juce::String&, juce::var::NativeFunction fn);
@@ -121,6 +240,64 @@ namespace reactjuce
          */
         void registerNativeProperty (const juce::String&, const juce::String&, const juce::var&);
 
+        //==============================================================================
+        /** The engine side of a call into a typed native function, giving direct access
+         *  to the arguments on the engine's value stack and to its return slot.
+         *
+         *  Strings returned by `getString` remain valid for the duration of the call.
+         */
+        struct NativeCallFrame
+        {
+            virtual ~NativeCallFrame() = default;
+
+            virtual double           getNumber (int index) = 0;
+            virtual bool             getBool (int index) = 0;
+            virtual std::string_view getString (int index) = 0;
+            virtual juce::var        getVar (int index) = 0;
+
+            virtual void returnNumber (double) = 0;
+            virtual void returnBool (bool) = 0;
+            virtual void returnString (std::string_view) = 0;
+            virtual void returnVar (const juce::var&) = 0;
+        };
+
+        using TypedNativeFunction = std::function<void(NativeCallFrame&)>;
+
+        /** Registers a native function with a fixed C++ signature by the given name
+         *  in the global namespace.
+         *
+         *  Unlike `registerNativeMethod`, arguments are read from the engine's value
+         *  stack straight into the typed parameters of the function, so that numeric,
+         *  boolean and `std::string_view` arguments are passed without constructing a
+         *  juce::var. Supported parameter and return types are `bool`, arithmetic types,
+         *  `std::string_view`, `juce::String` and `juce::var`; a `void` return leaves
+         *  the result undefined. For example:
+         *
+         *  ```
+         *  registerNativeFunction<double(double, double)>("add", [](double a, double b) {
+         *      return a + b;
+         *  });
+         *  ```
+         *
+         *  Calling the function from JavaScript with a different number of arguments
+         *  than the signature declares raises a TypeError. An argument of another type
+         *  than its parameter is converted as JavaScript's Number(), Boolean() or
+         *  String() would, whichever backend is in use.
+         */
+        template <typename Signature, typename Fn>
+        void registerNativeFunction (const juce::String& name, Fn&& fn);
+
+        /** Registers a native function with a fixed C++ signature by the given name on
+         *  the target object.
+         *
+         *  The provided target name may be any expression that leaves the target
+         *  object on the top of the stack, as with `registerNativeProperty`.
+         *
+         *  @throws EcmascriptEngine::Error in the event of an evaluation error
+         */
+        template <typename Signature, typename Fn>
+        void registerNativeFunction (const juce::String& target, const juce::String& name, Fn&& fn);
+
         //==============================================================================
         /** Invokes a method, applying the given args, inside the interpreter.
          *
@@ -150,9 +327,190 @@ namespace reactjuce
         juce::var invoke (const juce::String& name, T... args);
 
         //==============================================================================
-        /** Resets the internal Duktape context, clearing the value stack and destroying native callbacks. */
+        /** Resolves the function named by the given expression and pins it inside
+         *  the engine, returning a handle which may be invoked repeatedly without
+         *  looking the function up again.
+         *
+         *  The provided name may be any expression that leaves the target function
+         *  on the top of the stack, as with `invoke`.
+         *
+         *  @throws EcmascriptEngine::Error if the expression fails to evaluate or
+         *          does not produce a function.
+         */
+        FunctionHandle resolve (const juce::String& name);
+
+        /** Returns true if the given handle was resolved since the last `reset`. */
+        bool isValid (const FunctionHandle& handle) const;
+
+        /** Invokes a previously resolved function, applying the given args.
+         *
+         *  @returns juce::var result of the invocation
+         *  @throws EcmascriptEngine::Error in the event of an error, or if the
+         *          handle has been invalidated by a `reset`.
+         */
+        juce::var invoke (const FunctionHandle& handle, const std::vector<juce::var>& vargs);
+
+        /** Invokes a previously resolved function with the given args.
+         *
+         *  @returns juce::var result of the invocation
+         *  @throws EcmascriptEngine::Error in the event of an error, or if the
+         *          handle has been invalidated by a `reset`.
+         */
+        template <typename... T>
+        juce::var invoke (const FunctionHandle& handle, T... args);
+
+        //==============================================================================
+        /** A function which arranges for the given callback to run on the thread that
+         *  uses the engine.
+         */
+        using CallbackDispatcher = std::function<void(std::function<void()>)>;
+
+        /** Routes the callbacks the engine schedules for itself, such as those of
+         *  `setTimeout` and `setInterval`, through the given dispatcher.
+         *
+         *  Without a dispatcher these callbacks run directly on the message thread,
+         *  which is only safe while the engine is used from the message thread. Set
+         *  the dispatcher before evaluating any code on another thread.
+         */
+        void setCallbackDispatcher (CallbackDispatcher dispatcher);
+
+        //==============================================================================
+        /** Resets the internal Duktape context, clearing the value stack, destroying native
+         *  callbacks and invalidating any resolved function handles.
+         */
         void reset();
 
+        //==============================================================================
+        /** Returns the current memory statistics for the engine's JavaScript heap.
+         *
+         *  Statistics accumulate across calls to `reset`, so that the peak reflects the
+         *  most the engine has needed at any point.
+         *
+         *  Duktape counts its memory as it allocates, so its statistics may be read from
+         *  any thread. Hermes and QuickJS query their runtime, so with those this must be
+         *  called from the thread that uses the engine.
+         */
+        MemoryStats getMemoryStats() const;
+
+        /** Returns the current memory statistics along with those of the collections
+         *  run through `collectGarbage`. The collection statistics may be read from any
+         *  thread; the memory statistics follow `getMemoryStats`.
+         */
+        HeapStats getHeapStats() const;
+
+        /** Runs a full garbage collection, provided it is expected to complete within the
+         *  given budget, and returns whether it ran.
+         *
+         *  Neither engine can bound the length of a collection, so we predict it from the
+         *  duration of the previous one. Each declined request halves that prediction, so
+         *  that one slow collection doesn't rule out collecting for good. Intended to be
+         *  called when the application is idle, moving collection pauses away from the
+         *  moments the user is interacting.
+         */
+        bool collectGarbage (double budgetMs);
+
+        //==============================================================================
+        /** A record of where JavaScript time went, captured by sampling the call stack
+         *  between `startProfiling` and `stopProfiling`.
+         */
+        struct Profile
+        {
+            struct Frame
+            {
+                juce::String functionName;
+                juce::String fileName;
+                int lineNumber = 0;
+            };
+
+            struct Sample
+            {
+                /** When the sample was taken, in milliseconds. */
+                double timeMs = 0.0;
+
+                /** The call stack as indices into `frames`, outermost call first. */
+                std::vector<int> stack;
+            };
+
+            std::vector<Frame>  frames;
+            std::vector<Sample> samples;
+            double startTimeMs = 0.0;
+            double endTimeMs = 0.0;
+
+            /** Returns the samples in the collapsed stack format read by flamegraph.pl
+             *  and speedscope: one line per distinct call stack, with its frames
+             *  separated by semicolons and followed by the number of samples it took.
+             */
+            juce::String toCollapsedStacks() const;
+
+            /** Returns the profile in the `.cpuprofile` format read by the Chrome
+             *  DevTools performance panel.
+             */
+            juce::String toCpuProfile() const;
+        };
+
+        /** Starts sampling the JavaScript call stack roughly every `sampleIntervalMs`
+         *  while the engine runs code, discarding any profile already in progress.
+         *
+         *  Sampling is cheap enough to leave running while the UI is in use. Duktape
+         *  samples from its interrupt counter, so its samples are at least a few hundred
+         *  thousand instructions apart. Hermes samples at a fixed rate of its own, which
+         *  requires a Hermes build with its sampling profiler enabled. Its sampler is
+         *  shared by the whole process, so only one Hermes engine may profile at a time,
+         *  and starting a second throws an EcmascriptEngine::Error. QuickJS has no means
+         *  of sampling and throws an EcmascriptEngine::Error.
+         */
+        void startProfiling (double sampleIntervalMs = 1.0);
+
+        /** Stops sampling, returning the profile recorded since `startProfiling`. */
+        Profile stopProfiling();
+
+        /** Returns true between calls to `startProfiling` and `stopProfiling`. */
+        bool isProfiling() const;
+
+        //==============================================================================
+        /** Timings of the calls the engine has run, for judging how close they come
+         *  to the execution budget.
+         *
+         *  A call is any outermost entry into JavaScript: an evaluation, an invoke, a
+         *  timer, or a JavaScript function called through a var. JavaScript reentered
+         *  from native code within a call is counted as part of that call.
+         */
+        struct ExecutionStats
+        {
+            double lastCallMs = 0.0;
+            double longestCallMs = 0.0;
+            size_t numCalls = 0;
+
+            /** The number of calls which ran past the budget, whether or not the
+             *  engine managed to interrupt them.
+             */
+            size_t numBudgetsExceeded = 0;
+        };
+
+        /** Limits how long any single call into the engine may run, in milliseconds,
+         *  or removes the limit if given zero. The limit is off by default.
+         *
+         *  A call which runs past its budget is interrupted and throws an
+         *  EcmascriptEngine::Error, as any other error in the call would. Under
+         *  Duktape, a catch block in JavaScript sees the interruption, but it is
+         *  thrown again on the next instruction until the call has unwound.
+         *
+         *  Duktape checks the budget every few hundred thousand instructions, and
+         *  QuickJS every ten thousand or so. Hermes can only interrupt code compiled
+         *  after a budget was first set, so set one before evaluating the bundle;
+         *  precompiled bytecode must be compiled with `hermesc -emit-async-break-check`.
+         *  Hermes doesn't time JavaScript functions called through a var.
+         */
+        void setExecutionBudget (double budgetMs);
+
+        /** Returns the limit set by `setExecutionBudget`, or zero if there is none. */
+        double getExecutionBudget() const;
+
+        /** Returns the timings of the calls run since the engine was created. Safe to
+         *  call from any thread.
+         */
+        ExecutionStats getExecutionStats() const;
+
         //==============================================================================
         /** Pauses execution and waits for a debug client to attach and begin a debug session. */
         void debuggerAttach();
@@ -161,10 +519,39 @@ namespace reactjuce
         void debuggerDetach();
 
     private:
+        //==============================================================================
+        template <typename Signature>
+        struct TypedNativeFunctionBinder;
+
+        /** Installs a typed native function on the target object, or on the global
+         *  object if no target is given.
+         */
+        void registerTypedNativeFunction (const juce::String& target, const juce::String& name, int numArgs, TypedNativeFunction fn);
+
+        /** Return the compiled form of the given bundle from the process-wide cache,
+         *  compiling or loading it in this engine if it isn't there.
+         */
+        std::shared_ptr<const CompiledBundle> getCompiledSource (const juce::File& file);
+        std::shared_ptr<const CompiledBundle> getCompiledBytecode (const juce::File& file);
+        std::shared_ptr<const CompiledBundle> getCompiledBytecode (const void* data, size_t size, const juce::String& name);
+
+        /** Keeps the given bundle until the engine is next reset, returning it. */
+        const CompiledBundle& keepEvaluatedBundle (std::shared_ptr<const CompiledBundle> compiled);
+
         //==============================================================================
         struct Pimpl;
         std::unique_ptr<Pimpl> mPimpl;
 
+        // Written by the thread running collections and read by any thread
+        std::atomic<int>    numCollections { 0 };
+        std::atomic<double> lastCollectionMs { 0.0 };
+        std::atomic<double> totalCollectionMs { 0.0 };
+        std::atomic<double> expectedCollectionMs { 0.0 };
+
+        // The bundles evaluated since the last reset, which keep their entries in the
+        // compiled bundle cache alive
+        std::vector<std::shared_ptr<const CompiledBundle>> evaluatedBundles;
+
         //==============================================================================
         JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (EcmascriptEngine)
     };
@@ -178,4 +565,97 @@ namespace reactjuce
         return invoke(name, vargs);
     }
 
+    template <typename... T>
+    juce::var EcmascriptEngine::invoke (const FunctionHandle& handle, T... args)
+    {
+        std::vector<juce::var> vargs { args... };
+        return invoke(handle, vargs);
+    }
+
+    //==============================================================================
+    namespace detail
+    {
+        template <typename T>
+        constexpr bool isUnsupportedNativeType = false;
+
+        template <typename T>
+        T readNativeArgument (EcmascriptEngine::NativeCallFrame& frame, int index)
+        {
+            if constexpr (std::is_same_v<T, bool>)
+                return frame.getBool(index);
+            else if constexpr (std::is_arithmetic_v<T>)
+                return static_cast<T>(frame.getNumber(index));
+            else if constexpr (std::is_same_v<T, std::string_view>)
+                return frame.getString(index);
+            else if constexpr (std::is_same_v<T, juce::String>)
+            {
+                const auto s = frame.getString(index);
+                return juce::String::fromUTF8(s.data(), static_cast<int>(s.size()));
+            }
+            else if constexpr (std::is_same_v<T, juce::var>)
+                return frame.getVar(index);
+            else
+                static_assert(isUnsupportedNativeType<T>, "Unsupported native function parameter type");
+        }
+
+        template <typename T>
+        void writeNativeResult (EcmascriptEngine::NativeCallFrame& frame, const T& value)
+        {
+            if constexpr (std::is_same_v<T, bool>)
+                frame.returnBool(value);
+            else if constexpr (std::is_arithmetic_v<T>)
+                frame.returnNumber(static_cast<double>(value));
+            else if constexpr (std::is_same_v<T, std::string_view>)
+                frame.returnString(value);
+            else if constexpr (std::is_same_v<T, juce::String>)
+                frame.returnString({ value.toRawUTF8(), value.getNumBytesAsUTF8() });
+            else if constexpr (std::is_same_v<T, juce::var>)
+                frame.returnVar(value);
+            else
+                static_assert(isUnsupportedNativeType<T>, "Unsupported native function return type");
+        }
+    }
+
+    template <typename R, typename... Args>
+    struct EcmascriptEngine::TypedNativeFunctionBinder<R(Args...)>
+    {
+        static constexpr int numArgs = static_cast<int>(sizeof...(Args));
+
+        template <typename Fn>
+        static TypedNativeFunction bind (Fn&& fn)
+        {
+            static_assert(std::is_invocable_r_v<R, std::decay_t<Fn>&, Args...>,
+                          "The native function can't be called with the registered signature");
+
+            return [f = std::forward<Fn>(fn)] (NativeCallFrame& frame) mutable
+            {
+                call(f, frame, std::index_sequence_for<Args...>());
+            };
+        }
+
+        template <typename Fn, size_t... Indices>
+        static void call (Fn& f, NativeCallFrame& frame, std::index_sequence<Indices...>)
+        {
+            juce::ignoreUnused(frame);
+
+            if constexpr (std::is_void_v<R>)
+                f(detail::readNativeArgument<std::decay_t<Args>>(frame, static_cast<int>(Indices))...);
+            else
+                detail::writeNativeResult<std::decay_t<R>>(frame, f(detail::readNativeArgument<std::decay_t<Args>>(frame, static_cast<int>(Indices))...));
+        }
+    };
+
+    template <typename Signature, typename Fn>
+    void EcmascriptEngine::registerNativeFunction (const juce::String& name, Fn&& fn)
+    {
+        registerNativeFunction<Signature>(juce::String(), name, std::forward<Fn>(fn));
+    }
+
+    template <typename Signature, typename Fn>
+    void EcmascriptEngine::registerNativeFunction (const juce::String& target, const juce::String& name, Fn&& fn)
+    {
+        using Binder = TypedNativeFunctionBinder<Signature>;
+        registerTypedNativeFunction(target, name, Binder::numArgs, Binder::bind(std::forward<Fn>(fn)));
+    }
+
 }
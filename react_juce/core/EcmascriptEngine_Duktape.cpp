@@ -55,6 +55,19 @@
 // configs.
 #include <juce_core/system/juce_TargetPlatform.h>
 
+// Duktape calls this every few hundred thousand instructions with the heap's user
+// data, which is our Pimpl, and aborts execution if it returns true. The Pimpl
+// sets it up on construction since nothing out here can name it.
+namespace reactjuce
+{
+    namespace detail
+    {
+        static bool (*handleDuktapeInterrupt) (void* heapUserData) = nullptr;
+    }
+}
+
+#define REACTJUCE_DUKTAPE_INTERRUPT_HOOK(udata) reactjuce::detail::handleDuktapeInterrupt(udata)
+
 #include <duktape/src-noline/duktape.c>
 #include <duktape/extras/console/duk_console.c>
 
@@ -117,29 +130,367 @@ namespace reactjuce
             }
         }
 
-        static void safeCompileFile(duk_context* ctx, const juce::File& file)
+        static void safeCompileSource(duk_context* ctx, const juce::String& name, const juce::MemoryBlock& source)
         {
-            auto name = file.getFileName();
-            auto body = file.loadFileAsString();
-
             // Push the js filename to be compiled/evaluated
             duk_push_string(ctx, name.toRawUTF8());
 
-            if (duk_pcompile_string_filename(ctx, DUK_COMPILE_EVAL, body.toRawUTF8()) != DUK_EXEC_SUCCESS)
+            if (duk_pcompile_lstring_filename(ctx, DUK_COMPILE_EVAL, static_cast<const char*>(source.getData()), source.getSize()) != DUK_EXEC_SUCCESS)
+            {
+                const juce::String stack = duk_safe_to_stacktrace(ctx, -1);
+                const juce::String msg = duk_safe_to_string(ctx, -1);
+
+                throw EcmascriptEngine::Error(msg, stack, getContextDump(ctx));
+            }
+        }
+
+        static duk_ret_t loadFunctionUnsafe(duk_context* ctx, void* udata)
+        {
+            (void) udata; // Ignored in this case, silence warning
+            duk_load_function(ctx);
+            return 1;
+        }
+
+        /** Loads a function previously dumped with `duk_dump_function`, leaving it
+         *  on the stack top.
+         *
+         *  Duktape doesn't validate bytecode before loading it, so the file must have
+         *  been produced by a Duktape build of the same version and configuration.
+         */
+        static void safeLoadBytecode(duk_context* ctx, const juce::MemoryBlock& data)
+        {
+            // Point an external buffer at the data rather than copying it into the
+            // heap; the loader copies everything it needs out of the buffer.
+            duk_push_external_buffer(ctx);
+            duk_config_buffer(ctx, -1, const_cast<void*>(data.getData()), data.getSize());
+
+            if (duk_safe_call(ctx, loadFunctionUnsafe, nullptr, 1, 1) != DUK_EXEC_SUCCESS)
+            {
+                const juce::String stack = duk_safe_to_stacktrace(ctx, -1);
+                const juce::String msg = duk_safe_to_string(ctx, -1);
+
+                throw EcmascriptEngine::Error(msg, stack, getContextDump(ctx));
+            }
+        }
+
+        static duk_ret_t dumpFunctionUnsafe(duk_context* ctx, void* udata)
+        {
+            (void) udata; // Ignored in this case, silence warning
+            duk_dump_function(ctx);
+            return 1;
+        }
+
+        /** Dumps a copy of the function on the stack top to bytecode, leaving the
+         *  function itself in place.
+         */
+        static juce::MemoryBlock safeDumpFunction(duk_context* ctx)
+        {
+            duk_dup(ctx, -1);
+
+            if (duk_safe_call(ctx, dumpFunctionUnsafe, nullptr, 1, 1) != DUK_EXEC_SUCCESS)
             {
                 const juce::String stack = duk_safe_to_stacktrace(ctx, -1);
                 const juce::String msg = duk_safe_to_string(ctx, -1);
 
                 throw EcmascriptEngine::Error(msg, stack, getContextDump(ctx));
             }
+
+            duk_size_t size = 0;
+            const auto* data = duk_get_buffer_data(ctx, -1, &size);
+
+            juce::MemoryBlock bytecode (data, size);
+            duk_pop(ctx);
+
+            return bytecode;
         }
 
+        //==============================================================================
+        /** Serves the allocations of an engine's duktape heaps according to its
+         *  allocator policy, keeping count of the memory handed out.
+         *
+         *  Every block carries a small header recording its requested size, from which
+         *  we find its size class again on free and realloc. Pool pages are retained
+         *  for the lifetime of the allocator, so the memory freed by one heap is reused
+         *  by the next one after a reset.
+         */
+        class HeapAllocator
+        {
+        public:
+            explicit HeapAllocator (EcmascriptEngine::AllocatorPolicy p)
+                : policy(p) {}
+
+            ~HeapAllocator()
+            {
+                // If you hit this, a heap still holds memory from us as we're destroyed.
+                jassert(numLiveAllocations == 0);
+
+                for (auto* page : pages)
+                    std::free(page);
+            }
+
+            //==============================================================================
+            void* allocate (size_t size)
+            {
+                if (size == 0)
+                    return nullptr;
+
+                auto* header = static_cast<Header*>(isPooled(size) ? allocateFromPool(getSizeClass(size))
+                                                                   : std::malloc(sizeof(Header) + size));
+
+                if (header == nullptr)
+                    return nullptr;
+
+                header->size = size;
+                recordAllocation(size);
+
+                return header + 1;
+            }
+
+            void* reallocate (void* ptr, size_t size)
+            {
+                if (ptr == nullptr)
+                    return allocate(size);
+
+                if (size == 0)
+                {
+                    free(ptr);
+                    return nullptr;
+                }
+
+                auto* header = static_cast<Header*>(ptr) - 1;
+                const auto oldSize = header->size;
+
+                // A pooled block can stay where it is while it fits its size class, and
+                // a system block is left to the system to grow or shrink in place.
+                if (isPooled(oldSize) ? (isPooled(size) && getSizeClass(oldSize) == getSizeClass(size))
+                                      : ! isPooled(size))
+                {
+                    if (! isPooled(oldSize))
+                    {
+                        header = static_cast<Header*>(std::realloc(header, sizeof(Header) + size));
+
+                        if (header == nullptr)
+                            return nullptr;
+                    }
+
+                    header->size = size;
+                    recordResize(oldSize, size);
+
+                    return header + 1;
+                }
+
+                auto* moved = allocate(size);
+
+                if (moved != nullptr)
+                {
+                    std::memcpy(moved, ptr, std::min(oldSize, size));
+                    free(ptr);
+                }
+
+                return moved;
+            }
+
+            void free (void* ptr)
+            {
+                if (ptr == nullptr)
+                    return;
+
+                auto* header = static_cast<Header*>(ptr) - 1;
+                const auto size = header->size;
+
+                recordFree(size);
+
+                if (isPooled(size))
+                {
+                    auto* node = reinterpret_cast<FreeNode*>(header);
+                    const auto sizeClass = getSizeClass(size);
+
+                    node->next = freeLists[sizeClass];
+                    freeLists[sizeClass] = node;
+                    return;
+                }
+
+                std::free(header);
+            }
+
+            //==============================================================================
+            /** Returns the counts of memory handed out. Safe to call from any thread. */
+            EcmascriptEngine::MemoryStats getStats() const
+            {
+                EcmascriptEngine::MemoryStats stats;
+                stats.liveBytes = liveBytes.load(std::memory_order_relaxed);
+                stats.peakBytes = peakBytes.load(std::memory_order_relaxed);
+                stats.numLiveAllocations = numLiveAllocations.load(std::memory_order_relaxed);
+                stats.numAllocations = numAllocations.load(std::memory_order_relaxed);
+                return stats;
+            }
+
+        private:
+            //==============================================================================
+            struct alignas(std::max_align_t) Header { size_t size; };
+            struct FreeNode { FreeNode* next; };
+
+            static constexpr size_t minBlockSize   = 16;
+            static constexpr size_t numSizeClasses = 6;
+            static constexpr size_t poolPageSize   = 16 * 1024;
+            static constexpr size_t arenaSlabSize  = 1024 * 1024;
+
+            /** Returns the index of the smallest size class holding the given size, or
+             *  numSizeClasses if it's too large for any of them.
+             */
+            static size_t getSizeClass (size_t size)
+            {
+                size_t sizeClass = 0;
+
+                while (sizeClass < numSizeClasses && (minBlockSize << sizeClass) < size)
+                    ++sizeClass;
+
+                return sizeClass;
+            }
+
+            bool isPooled (size_t size) const
+            {
+                return policy != EcmascriptEngine::AllocatorPolicy::System && getSizeClass(size) < numSizeClasses;
+            }
+
+            void* allocateFromPool (size_t sizeClass)
+            {
+                if (freeLists[sizeClass] == nullptr && ! addPoolPage(sizeClass))
+                    return nullptr;
+
+                auto* node = freeLists[sizeClass];
+                freeLists[sizeClass] = node->next;
+                return node;
+            }
+
+            /** Carves a new page into blocks of the given size class and threads them
+             *  onto its free list.
+             */
+            bool addPoolPage (size_t sizeClass)
+            {
+                auto* page = static_cast<char*>(allocatePage());
+
+                if (page == nullptr)
+                    return false;
+
+                const auto blockSize = sizeof(Header) + (minBlockSize << sizeClass);
+
+                for (size_t offset = 0; offset + blockSize <= poolPageSize; offset += blockSize)
+                {
+                    auto* node = reinterpret_cast<FreeNode*>(page + offset);
+                    node->next = freeLists[sizeClass];
+                    freeLists[sizeClass] = node;
+                }
+
+                return true;
+            }
+
+            void* allocatePage()
+            {
+                if (policy != EcmascriptEngine::AllocatorPolicy::PooledArena)
+                {
+                    auto* page = std::malloc(poolPageSize);
+
+                    if (page != nullptr)
+                        pages.push_back(page);
+
+                    return page;
+                }
+
+                if (arenaCursor == nullptr || arenaCursor + poolPageSize > arenaEnd)
+                {
+                    auto* slab = static_cast<char*>(std::malloc(arenaSlabSize));
+
+                    if (slab == nullptr)
+                        return nullptr;
+
+                    pages.push_back(slab);
+                    arenaCursor = slab;
+                    arenaEnd = slab + arenaSlabSize;
+                }
+
+                auto* page = arenaCursor;
+                arenaCursor += poolPageSize;
+                return page;
+            }
+
+            // Only the thread running the heap writes the counters, so each is updated
+            // with a plain load and store rather than a locked read-modify-write. They
+            // are atomic so that the stats may be read while the heap runs elsewhere.
+            static void add (std::atomic<size_t>& counter, size_t delta)
+            {
+                counter.store(counter.load(std::memory_order_relaxed) + delta, std::memory_order_relaxed);
+            }
+
+            static void subtract (std::atomic<size_t>& counter, size_t delta)
+            {
+                counter.store(counter.load(std::memory_order_relaxed) - delta, std::memory_order_relaxed);
+            }
+
+            void updatePeak()
+            {
+                const auto live = liveBytes.load(std::memory_order_relaxed);
+
+                if (live > peakBytes.load(std::memory_order_relaxed))
+                    peakBytes.store(live, std::memory_order_relaxed);
+            }
+
+            void recordAllocation (size_t size)
+            {
+                add(liveBytes, size);
+                updatePeak();
+                add(numLiveAllocations, 1);
+                add(numAllocations, 1);
+            }
+
+            void recordResize (size_t oldSize, size_t newSize)
+            {
+                subtract(liveBytes, oldSize);
+                add(liveBytes, newSize);
+                updatePeak();
+            }
+
+            void recordFree (size_t size)
+            {
+                subtract(liveBytes, size);
+                subtract(numLiveAllocations, 1);
+            }
+
+            //==============================================================================
+            const EcmascriptEngine::AllocatorPolicy policy;
+
+            std::array<FreeNode*, numSizeClasses> freeLists {};
+            std::vector<void*> pages;
+            char* arenaCursor = nullptr;
+            char* arenaEnd = nullptr;
+
+            std::atomic<size_t> liveBytes { 0 };
+            std::atomic<size_t> peakBytes { 0 };
+            std::atomic<size_t> numLiveAllocations { 0 };
+            std::atomic<size_t> numAllocations { 0 };
+        };
+
     }
 
+    //==============================================================================
+    /** The compiled form of a bundle is its dumped bytecode, which loads into any
+     *  Duktape heap without parsing or compiling.
+     */
+    struct EcmascriptEngine::CompiledBundle
+    {
+        juce::String name;
+        juce::MemoryBlock bytecode;
+    };
+
     //==============================================================================
     struct EcmascriptEngine::Pimpl : private juce::Timer
     {
-        Pimpl() { reset(); }
+        explicit Pimpl (AllocatorPolicy policy)
+            : heapAllocator(policy)
+        {
+            detail::handleDuktapeInterrupt = &Pimpl::handleInterrupt;
+            reset();
+        }
 
         ~Pimpl() override
         {
@@ -152,6 +503,7 @@ namespace reactjuce
         {
             jassert(code.isNotEmpty());
             auto* ctxRawPtr = dukContext.get();
+            detail::ExecutionBudget::Scope budgetScope (executionBudget);
 
             try {
                 detail::safeEvalString(ctxRawPtr, code);
@@ -166,14 +518,47 @@ namespace reactjuce
             return result;
         }
 
-        juce::var evaluate (const juce::File& code)
+        //==============================================================================
+        std::shared_ptr<const CompiledBundle> compile (const juce::File& code, const juce::MemoryBlock& data)
         {
-            jassert(code.existsAsFile());
-            jassert(code.loadFileAsString().isNotEmpty());
+            auto compiled = std::make_shared<CompiledBundle>();
+            compiled->name = code.getFullPathName();
+
             auto* ctxRawPtr = dukContext.get();
 
             try {
-                detail::safeCompileFile(ctxRawPtr, code);
+                detail::safeCompileSource(ctxRawPtr, code.getFileName(), data);
+                compiled->bytecode = detail::safeDumpFunction(ctxRawPtr);
+            } catch (Error const& err) {
+                reset();
+                throw err;
+            }
+
+            duk_pop(ctxRawPtr);
+            return compiled;
+        }
+
+        std::shared_ptr<const CompiledBundle> compileBytecode (const juce::String& name, std::shared_ptr<const void> owner, const void* data, size_t size)
+        {
+            // Bytecode is already in the form we keep, but Duktape copies it into the
+            // heap on every load regardless, so there's nothing to gain by keeping
+            // the caller's buffer rather than a copy of it
+            juce::ignoreUnused(owner);
+
+            auto compiled = std::make_shared<CompiledBundle>();
+            compiled->name = name;
+            compiled->bytecode = juce::MemoryBlock(data, size);
+
+            return compiled;
+        }
+
+        juce::var evaluateCompiled (const CompiledBundle& compiled)
+        {
+            auto* ctxRawPtr = dukContext.get();
+            detail::ExecutionBudget::Scope budgetScope (executionBudget);
+
+            try {
+                detail::safeLoadBytecode(ctxRawPtr, compiled.bytecode);
                 detail::safeCall(ctxRawPtr, 0);
             } catch (Error const& err) {
                 reset();
@@ -187,11 +572,6 @@ namespace reactjuce
             return result;
         }
 
-        juce::var evaluateBytecode(const juce::File &code)
-        {
-            throw Error("Duktape engine does not currently support bytecode evaluation");
-        }
-
         //==============================================================================
         void registerNativeProperty (const juce::String& name, const juce::var& value)
         {
@@ -220,10 +600,47 @@ namespace reactjuce
             duk_pop(ctxRawPtr);
         }
 
+        //==============================================================================
+        void registerTypedNativeFunction (const juce::String& target, const juce::String& name, int numArgs, TypedNativeFunction fn)
+        {
+            auto* ctxRawPtr = dukContext.get();
+
+            if (target.isEmpty())
+            {
+                duk_push_global_object(ctxRawPtr);
+            }
+            else
+            {
+                try {
+                    detail::safeEvalString(ctxRawPtr, target);
+                } catch (Error const& err) {
+                    reset();
+                    throw err;
+                }
+            }
+
+            // We identify the function by its index in the typed function pool, which
+            // we carry in the function's magic value so that a call needs no property
+            // lookups to find it.
+            const auto index = static_cast<int>(typedFunctionPool.size());
+
+            // If you hit this, you've registered more typed functions than can be
+            // indexed by a Duktape magic value.
+            jassert(index <= std::numeric_limits<duk_int16_t>::max());
+
+            typedFunctionPool.push_back({ std::move(fn), numArgs });
+
+            duk_push_c_function(ctxRawPtr, TypedFunctionHelper::invokeFromDukContext, DUK_VARARGS);
+            duk_set_magic(ctxRawPtr, -1, index);
+            duk_put_prop_string(ctxRawPtr, -2, name.toRawUTF8());
+            duk_pop(ctxRawPtr);
+        }
+
         //==============================================================================
         juce::var invoke (const juce::String& name, const std::vector<juce::var>& vargs)
         {
             auto* ctxRawPtr = dukContext.get();
+            detail::ExecutionBudget::Scope budgetScope (executionBudget);
 
             try {
                 detail::safeEvalString(ctxRawPtr, name);
@@ -232,15 +649,66 @@ namespace reactjuce
                     throw Error("Invocation failed, target is not a function.");
                 }
 
-                // Push the args to the duktape stack
-                const auto nargs = static_cast<duk_idx_t>(vargs.size());
-                duk_require_stack_top(ctxRawPtr, nargs);
+                callFunctionOnStackTop(vargs);
+            } catch (Error const& err) {
+                reset();
+                throw err;
+            }
+
+            // Collect the return value
+            auto result = readVarFromDukStack(dukContext, -1);
+            duk_pop(ctxRawPtr);
+
+            return result;
+        }
+
+        //==============================================================================
+        FunctionHandle resolve (const juce::String& name)
+        {
+            auto* ctxRawPtr = dukContext.get();
+
+            try {
+                detail::safeEvalString(ctxRawPtr, name);
+
+                if (!duk_is_function(ctxRawPtr, -1)) {
+                    throw Error("Resolve failed, target is not a function.");
+                }
+            } catch (Error const& err) {
+                reset();
+                throw err;
+            }
+
+            // Pin the function in our resolved function table, keyed by its handle index
+            const auto index = numResolvedFunctions++;
+
+            pushResolvedFunctionTable(ctxRawPtr);
+            duk_swap_top(ctxRawPtr, -2);
+            duk_put_prop_index(ctxRawPtr, -2, static_cast<duk_uarridx_t>(index));
+            duk_pop(ctxRawPtr);
+
+            return { index, generation };
+        }
 
-                for (auto& p : vargs)
-                    pushVarToDukStack(dukContext, p);
+        bool isValid (const FunctionHandle& handle) const
+        {
+            return handle.generation == generation && juce::isPositiveAndBelow(handle.index, numResolvedFunctions);
+        }
 
-                // Invocation
-                detail::safeCall(ctxRawPtr, nargs);
+        juce::var invoke (const FunctionHandle& handle, const std::vector<juce::var>& vargs)
+        {
+            if (!isValid(handle))
+                throw Error("Invocation failed, the function handle is no longer valid.");
+
+            auto* ctxRawPtr = dukContext.get();
+            detail::ExecutionBudget::Scope budgetScope (executionBudget);
+
+            // Leave only the resolved function on the stack top
+            pushResolvedFunctionTable(ctxRawPtr);
+            duk_get_prop_index(ctxRawPtr, -1, static_cast<duk_uarridx_t>(handle.index));
+            duk_remove(ctxRawPtr, -2);
+
+            try {
+                callFunctionOnStackTop(vargs);
             } catch (Error const& err) {
                 reset();
                 throw err;
@@ -253,102 +721,154 @@ namespace reactjuce
             return result;
         }
 
-        struct TimeoutFunctionManager : private juce::MultiTimer
+        /** Schedules the engine's timeouts and intervals on a single native timer, set
+         *  for whichever of them is due next.
+         */
+        struct TimeoutFunctionManager : private juce::Timer
         {
+            explicit TimeoutFunctionManager(std::function<void()> onTimersDue)
+                : dispatchTimers(std::move(onTimersDue)) {}
+
             ~TimeoutFunctionManager() override {
-                for(const auto &[id, timer] : timeoutFunctions)
-                    stopTimer(id);
+                stopTimer();
             }
 
-            juce::var clearTimeout(const int id)
+            void clearTimeout(const int id)
             {
-                stopTimer(id);
-                const auto f = timeoutFunctions.find(id);
-                if(f != timeoutFunctions.cend())
-                    timeoutFunctions.erase(f);
-                return juce::var();
+                timers.remove(id);
+                scheduleNextTimer();
             }
 
-            int newTimeout(const juce::var::NativeFunction f, const int timeoutMillis, const std::vector<juce::var>&& args, const bool repeats=false)
+            int newTimeout(const double timeoutMillis, const bool repeats)
             {
-                static int nextId = 0;
-                timeoutFunctions.emplace(nextId, TimeoutFunction(f, std::move(args), repeats));
-                startTimer(nextId, timeoutMillis);
-                return nextId++;
+                const int id = timers.add(timeoutMillis, repeats, juce::Time::getMillisecondCounterHiRes());
+                scheduleNextTimer();
+                return id;
             }
 
-            void timerCallback(int id) override
+            void timerCallback() override
             {
-                const auto f = timeoutFunctions.find(id);
-                if(f != timeoutFunctions.cend())
-                {
-                    const auto cb = f->second;
-                    std::invoke(cb.f, juce::var::NativeFunctionArgs(juce::var(), cb.args.data(), static_cast<int>(cb.args.size())));
-                    if(!cb.repeats)
-                    {
-                        stopTimer(id);
-                        timeoutFunctions.erase(f);
-                    }
-                }
+                // The due timers may run on another thread, which reschedules us
+                stopTimer();
+                dispatchTimers();
+            }
+
+            /** Returns the ids of every timeout which is due, in the order they fell due. */
+            std::vector<int> takeDueTimeouts()
+            {
+                auto due = timers.takeExpired(juce::Time::getMillisecondCounterHiRes());
+                scheduleNextTimer();
+                return due;
             }
 
         private:
-            struct TimeoutFunction
+            void scheduleNextTimer()
             {
-                TimeoutFunction(const juce::var::NativeFunction _f, const std::vector<juce::var> &&_args, const bool _repeats=false)
-                    : f(_f), args(std::move(_args)), repeats(_repeats) {}
+                const auto dueTime = timers.getNextDueTime();
 
-                const juce::var::NativeFunction f;
-                std::vector<juce::var> args;
-                const bool repeats;
-            };
+                if (dueTime < 0.0)
+                    return stopTimer();
 
-            std::map<int, TimeoutFunction> timeoutFunctions;
+                const auto delayMs = dueTime - juce::Time::getMillisecondCounterHiRes();
+                startTimer(juce::jmax(1, static_cast<int>(std::ceil(delayMs))));
+            }
+
+            detail::TimerQueue timers;
+            std::function<void()> dispatchTimers;
         };
 
-        // IsSetter is true for setTimeout / setInterval
-        // and false for clearTimeout / clearInterval
-        template <bool IsSetter = false, bool Repeats = false, typename MethodType>
-        void registerNativeTimerFunction(const char* name, MethodType method)
+        /** Called on the message thread when timeouts fall due. */
+        void dispatchTimeouts()
         {
-            registerNativeProperty(name, juce::var::NativeFunction([this, name, method] (const juce::var::NativeFunctionArgs& _args) -> juce::var {
-                if constexpr (IsSetter)
-                {
-                    if(_args.numArguments < 2 || !_args.arguments[0].isMethod() || !_args.arguments[1].isDouble())
-                        throw Error(juce::String(name) + " requires a callback and time in milliseconds");
-                    // build a vector holding all additional arguments
-                    std::vector<juce::var> args(_args.arguments + 2, _args.arguments + _args.numArguments);
-                    return (this->timeoutsManager.get()->*method)(_args.arguments[0].getNativeFunction(), _args.arguments[1], std::move(args), Repeats);
-                }
-                else
-                {
-                    if(_args.numArguments < 1 || !_args.arguments[0].isDouble())
-                        throw Error(juce::String(name) + " requires an integer ID of the timer to clear");
-                    return (this->timeoutsManager.get()->*method)(_args.arguments[0]);
-                }
-            }));
+            if (!callbackDispatcher)
+                return runDueTimeouts();
+
+            // Whichever manager is current once the callback runs works out for itself
+            // which of its timeouts are due, so a reset in between is harmless.
+            callbackDispatcher([this] {
+                if (timeoutsManager)
+                    runDueTimeouts();
+            });
         }
 
-        void registerTimerGlobals()
+        /** Hands every timeout which is due to the timer trampoline in a single call. */
+        void runDueTimeouts()
         {
-            registerNativeTimerFunction<true>(
-                "setTimeout", &TimeoutFunctionManager::newTimeout
-            );
-            registerNativeTimerFunction<true, true>(
-                "setInterval", &TimeoutFunctionManager::newTimeout
-            );
-            registerNativeTimerFunction("clearTimeout", &TimeoutFunctionManager::clearTimeout);
-            registerNativeTimerFunction("clearInterval", &TimeoutFunctionManager::clearTimeout);
+            const auto due = timeoutsManager->takeDueTimeouts();
+
+            if (due.empty())
+                return;
+
+            auto* ctxRawPtr = dukContext.get();
+            detail::ExecutionBudget::Scope budgetScope (executionBudget);
+
+            duk_push_heapptr(ctxRawPtr, runTimersFunction);
+            duk_push_array(ctxRawPtr);
+
+            for (size_t i = 0; i < due.size(); ++i)
+            {
+                duk_push_int(ctxRawPtr, due[i]);
+                duk_put_prop_index(ctxRawPtr, -2, static_cast<duk_uarridx_t>(i));
+            }
+
+            try {
+                detail::safeCall(ctxRawPtr, 1);
+            } catch (Error const& err) {
+                reset();
+                throw err;
+            }
+
+            duk_pop(ctxRawPtr);
+        }
+
+        void setCallbackDispatcher(CallbackDispatcher dispatcher)
+        {
+            callbackDispatcher = std::move(dispatcher);
+        }
+
+        /** Installs the timer globals, whose callbacks live in a table on the JavaScript
+         *  side, and pins the trampoline that runs them.
+         */
+        void installTimerGlobals()
+        {
+            auto* ctxRawPtr = dukContext.get();
+
+            detail::safeEvalString(ctxRawPtr, detail::timerGlobalsScript);
+            duk_push_global_object(ctxRawPtr);
+
+            pushVarToDukStack(dukContext, juce::var::NativeFunction([this] (const juce::var::NativeFunctionArgs& args) -> juce::var {
+                jassert(args.numArguments == 2);
+                return timeoutsManager->newTimeout(args.arguments[0], args.arguments[1]);
+            }), true);
+
+            pushVarToDukStack(dukContext, juce::var::NativeFunction([this] (const juce::var::NativeFunctionArgs& args) -> juce::var {
+                jassert(args.numArguments == 1);
+                timeoutsManager->clearTimeout(args.arguments[0]);
+                return juce::var();
+            }), true);
+
+            detail::safeCall(ctxRawPtr, 3);
+
+            // Pin the trampoline in the stash, addressing it by heap pointer from here on
+            runTimersFunction = duk_get_heapptr(ctxRawPtr, -1);
+            duk_push_global_stash(ctxRawPtr);
+            duk_swap_top(ctxRawPtr, -2);
+            duk_put_prop_string(ctxRawPtr, -2, DUK_HIDDEN_SYMBOL("__RunTimers__"));
+            duk_pop(ctxRawPtr);
         }
 
         void reset()
         {
             // Clear out any timer callbacks
-            timeoutsManager = std::make_unique<TimeoutFunctionManager>();
+            timeoutsManager = std::make_unique<TimeoutFunctionManager>([this]() { dispatchTimeouts(); });
 
             // Allocate a new js heap
             dukContext = std::shared_ptr<duk_context>(
-                duk_create_heap (nullptr, nullptr, nullptr, nullptr, detail::fatalErrorHandler),
+                duk_create_heap (allocFunction,
+                                 reallocFunction,
+                                 freeFunction,
+                                 this,
+                                 detail::fatalErrorHandler),
                 duk_destroy_heap
             );
 
@@ -362,11 +882,51 @@ namespace reactjuce
             duk_put_prop_string(ctxRawPtr, -2, DUK_HIDDEN_SYMBOL("__EcmascriptEngineInstance__"));
             duk_pop(ctxRawPtr);
 
+            // Install an empty table for resolved function handles, invalidating
+            // any handles into the previous context instance
+            duk_push_global_stash(ctxRawPtr);
+            duk_push_array(ctxRawPtr);
+            duk_put_prop_string(ctxRawPtr, -2, DUK_HIDDEN_SYMBOL("__ResolvedFunctions__"));
+            duk_pop(ctxRawPtr);
+
+            numResolvedFunctions = 0;
+            ++generation;
+
+            // Install an empty table for the callbacks we hand to native code, which
+            // we'll address by heap pointer from here on
+            duk_push_global_stash(ctxRawPtr);
+            duk_push_array(ctxRawPtr);
+            callbackTable = duk_get_heapptr(ctxRawPtr, -1);
+            duk_put_prop_string(ctxRawPtr, -2, DUK_HIDDEN_SYMBOL("__Callbacks__"));
+            duk_pop(ctxRawPtr);
+
+            callbackSlots.clear();
+            firstFreeCallbackSlot = -1;
+
+            // Install an empty table pinning the interned object keys
+            duk_push_global_stash(ctxRawPtr);
+            duk_push_array(ctxRawPtr);
+            duk_put_prop_string(ctxRawPtr, -2, DUK_HIDDEN_SYMBOL("__PropertyKeys__"));
+            duk_pop(ctxRawPtr);
+
+            keysByIdentifier.clear();
+            identifiersByKey.clear();
+
             // Clear out any lambdas attached to the previous context instance
             persistentReleasePool.clear();
+            typedFunctionPool.clear();
+            temporaryCallbacks.clear();
+            firstFreeTemporaryCallback = -1;
 
-            // Register our various timeout-related native functions
-            registerTimerGlobals();
+            // Install the finalizer shared by every temporary native function
+            duk_push_global_stash(ctxRawPtr);
+            duk_push_c_function(ctxRawPtr, TemporaryCallback::finalizer, 1);
+            temporaryCallbackFinalizer = duk_get_heapptr(ctxRawPtr, -1);
+            duk_put_prop_string(ctxRawPtr, -2, DUK_HIDDEN_SYMBOL("__TemporaryCallbackFinalizer__"));
+            duk_pop(ctxRawPtr);
+
+            // Install our timer globals and the trampoline which runs them
+            installTimerGlobals();
         }
 
         //==============================================================================
@@ -393,146 +953,327 @@ namespace reactjuce
                                 },
                                 this);
 
-            // Start timer for duk_debugger_cooperate calls
-            startTimer(200);
-        }
+            // Start timer for duk_debugger_cooperate calls
+            startTimer(200);
+        }
+
+        void debuggerDetach()
+        {
+            if (auto* dc = dukContext.get())
+                duk_debugger_detach (dc);
+        }
+
+        //==============================================================================
+        void timerCallback() override
+        {
+            if (auto* dc = dukContext.get())
+                duk_debugger_cooperate (dc);
+        }
+
+        //==============================================================================
+        struct LambdaHelper {
+            LambdaHelper(juce::var::NativeFunction fn, uint32_t _id)
+                : callback(std::move(fn)), id(_id) {}
+
+            static duk_ret_t invokeFromDukContext(duk_context* ctx)
+            {
+                // First we have to retrieve the actual function pointer and our engine pointer
+                // See: https://duktape.org/guide.html#hidden-symbol-properties
+                duk_push_current_function(ctx);
+                duk_get_prop_string(ctx, -1, DUK_HIDDEN_SYMBOL("LambdaHelperPtr"));
+
+                LambdaHelper* helper = static_cast<LambdaHelper*>(duk_get_pointer(ctx, -1));
+                duk_pop(ctx);
+
+                // Then the engine...
+                duk_get_prop_string(ctx, -1, DUK_HIDDEN_SYMBOL("EnginePtr"));
+                auto* engine = static_cast<EcmascriptEngine::Pimpl*>(duk_get_pointer(ctx, -1));
+
+                // Pop back both the pointer and the "current function"
+                duk_pop_2(ctx);
+
+                return invokeNativeFunction(*engine, ctx, helper->callback);
+            }
+
+            static duk_ret_t callbackFinalizer (duk_context* ctx)
+            {
+                // First we have to retrieve the actual function pointer and our engine pointer
+                // See: https://duktape.org/guide.html#hidden-symbol-properties
+                // And: https://duktape.org/api.html#duk_set_finalizer
+                // In this case our function is at index 0.
+                duk_require_function(ctx, 0);
+                duk_get_prop_string(ctx, 0, DUK_HIDDEN_SYMBOL("LambdaHelperPtr"));
+
+                LambdaHelper* helper = static_cast<LambdaHelper*>(duk_get_pointer(ctx, -1));
+                duk_pop(ctx);
+
+                // Then the engine...
+                duk_get_prop_string(ctx, 0, DUK_HIDDEN_SYMBOL("EnginePtr"));
+                auto* engine = static_cast<EcmascriptEngine::Pimpl*>(duk_get_pointer(ctx, -1));
+
+                // Pop back both the pointer and the "current function"
+                duk_pop_2(ctx);
+
+                // Clean up our lambda helper
+                engine->removeLambdaHelper(helper);
+                return 0;
+            }
+
+            juce::var::NativeFunction callback;
+            uint32_t id;
+        };
+
+        //==============================================================================
+        /** A slot of the temporary callback slab, which doubles as a free list node
+         *  while the slot is unused.
+         */
+        struct TemporaryCallback
+        {
+            static duk_ret_t invokeFromDukContext (duk_context* ctx)
+            {
+                // The heap's user data points back at our engine, and the function's
+                // magic value indexes its slot in the slab.
+                duk_memory_functions memoryFunctions;
+                duk_get_memory_functions(ctx, &memoryFunctions);
+
+                auto* engine = static_cast<EcmascriptEngine::Pimpl*>(memoryFunctions.udata);
+                const auto index = static_cast<size_t>(duk_get_current_magic(ctx));
+
+                return invokeNativeFunction(*engine, ctx, engine->temporaryCallbacks[index].callback);
+            }
+
+            static duk_ret_t finalizer (duk_context* ctx)
+            {
+                duk_memory_functions memoryFunctions;
+                duk_get_memory_functions(ctx, &memoryFunctions);
+
+                auto* engine = static_cast<EcmascriptEngine::Pimpl*>(memoryFunctions.udata);
+
+                // A heap being torn down after a reset finalizes functions whose slots
+                // were already discarded with it.
+                if (ctx == engine->dukContext.get())
+                    engine->releaseTemporaryCallback(duk_get_magic(ctx, 0));
+
+                return 0;
+            }
+
+            juce::var::NativeFunction callback;
+            int nextFree = -1;
+        };
+
+        //==============================================================================
+        struct TypedFunctionHelper
+        {
+            /** Gives a typed native function direct access to the duktape value stack. */
+            struct DukCallFrame : public NativeCallFrame
+            {
+                DukCallFrame(Pimpl& e, duk_context* c)
+                    : engine(e), ctx(c) {}
+
+                double getNumber (int index) override             { return duk_to_number(ctx, index); }
+                bool getBool (int index) override                 { return duk_to_boolean(ctx, index); }
+                juce::var getVar (int index) override             { return engine.readVarFromDukStack(engine.dukContext, index); }
+
+                std::string_view getString (int index) override
+                {
+                    duk_size_t length = 0;
+                    const char* s = duk_to_lstring(ctx, index, &length);
+                    return { s, static_cast<size_t>(length) };
+                }
+
+                void returnNumber (double value) override         { duk_push_number(ctx, value); hasResult = true; }
+                void returnBool (bool value) override             { duk_push_boolean(ctx, value); hasResult = true; }
+                void returnVar (const juce::var& value) override  { engine.pushVarToDukStack(engine.dukContext, value); hasResult = true; }
+
+                void returnString (std::string_view value) override
+                {
+                    duk_push_lstring(ctx, value.data(), value.size());
+                    hasResult = true;
+                }
+
+                Pimpl& engine;
+                duk_context* ctx;
+                bool hasResult = false;
+            };
+
+            static duk_ret_t invokeFromDukContext(duk_context* ctx)
+            {
+                // The heap's user data points back at our engine, and the function's
+                // magic value indexes its entry in the typed function pool.
+                duk_memory_functions memoryFunctions;
+                duk_get_memory_functions(ctx, &memoryFunctions);
+
+                auto* engine = static_cast<EcmascriptEngine::Pimpl*>(memoryFunctions.udata);
+                auto& entry = engine->typedFunctionPool[static_cast<size_t>(duk_get_current_magic(ctx))];
+
+                if (duk_get_top(ctx) != entry.numArgs)
+                {
+                    duk_push_error_object(ctx, DUK_ERR_TYPE_ERROR, "Native function expected %d arguments but received %d",
+                                          entry.numArgs, static_cast<int>(duk_get_top(ctx)));
+                    return duk_throw(ctx);
+                }
+
+                DukCallFrame frame(*engine, ctx);
+
+                try
+                {
+                    entry.fn(frame);
+                }
+                catch (Error& err)
+                {
+                    duk_push_error_object(ctx, DUK_ERR_TYPE_ERROR, "%s", err.what());
+                    return duk_throw(ctx);
+                }
+
+                return frame.hasResult ? 1 : 0;
+            }
+
+            TypedNativeFunction fn;
+            int numArgs;
+        };
 
-        void debuggerDetach()
+        //==============================================================================
+        /** Helper for invoking the function on the top of the duktape stack, leaving
+         *  the result in its place.
+         */
+        void callFunctionOnStackTop (const std::vector<juce::var>& vargs)
         {
-            if (auto* dc = dukContext.get())
-                duk_debugger_detach (dc);
+            auto* ctxRawPtr = dukContext.get();
+
+            // Push the args to the duktape stack
+            const auto nargs = static_cast<duk_idx_t>(vargs.size());
+            duk_require_stack_top(ctxRawPtr, nargs);
+
+            for (auto& p : vargs)
+                pushVarToDukStack(dukContext, p);
+
+            // Invocation
+            detail::safeCall(ctxRawPtr, nargs);
         }
 
-        //==============================================================================
-        void timerCallback() override
+        /** Helper for pushing the stashed table of resolved functions to the duktape stack. */
+        static void pushResolvedFunctionTable (duk_context* ctx)
         {
-            if (auto* dc = dukContext.get())
-                duk_debugger_cooperate (dc);
+            duk_push_global_stash(ctx);
+            duk_get_prop_string(ctx, -1, DUK_HIDDEN_SYMBOL("__ResolvedFunctions__"));
+            duk_remove(ctx, -2);
         }
 
         //==============================================================================
-        struct LambdaHelper {
-            LambdaHelper(juce::var::NativeFunction fn, uint32_t _id)
-                : callback(std::move(fn)), id(_id) {}
+        /** Pushes a wrapper function which owns a LambdaHelper for the given native
+         *  function until the wrapper is finalized.
+         */
+        void pushPersistentNativeFunction (juce::var::NativeFunction fn)
+        {
+            auto* ctxRawPtr = dukContext.get();
 
-            static duk_ret_t invokeFromDukContext(duk_context* ctx)
-            {
-                // First we have to retrieve the actual function pointer and our engine pointer
-                // See: https://duktape.org/guide.html#hidden-symbol-properties
-                duk_push_current_function(ctx);
-                duk_get_prop_string(ctx, -1, DUK_HIDDEN_SYMBOL("LambdaHelperPtr"));
+            // For persisted native functions, we provide a helper layer storing and retrieving the
+            // stash, and marshalling between the Duktape C interface and the NativeFunction interface
+            duk_push_c_function(ctxRawPtr, LambdaHelper::invokeFromDukContext, DUK_VARARGS);
 
-                LambdaHelper* helper = static_cast<LambdaHelper*>(duk_get_pointer(ctx, -1));
-                duk_pop(ctx);
+            // Now we assign the pointers as properties of the wrapper function
+            auto helper = std::make_unique<LambdaHelper>(std::move(fn), nextHelperId++);
+            duk_push_pointer(ctxRawPtr, (void *) helper.get());
+            duk_put_prop_string(ctxRawPtr, -2, DUK_HIDDEN_SYMBOL("LambdaHelperPtr"));
+            duk_push_pointer(ctxRawPtr, (void *) this);
+            duk_put_prop_string(ctxRawPtr, -2, DUK_HIDDEN_SYMBOL("EnginePtr"));
 
-                // Then the engine...
-                duk_get_prop_string(ctx, -1, DUK_HIDDEN_SYMBOL("EnginePtr"));
-                auto* engine = static_cast<EcmascriptEngine::Pimpl*>(duk_get_pointer(ctx, -1));
+            // Now we prepare the finalizer
+            duk_push_c_function(ctxRawPtr, LambdaHelper::callbackFinalizer, 1);
+            duk_push_pointer(ctxRawPtr, (void *) helper.get());
+            duk_put_prop_string(ctxRawPtr, -2, DUK_HIDDEN_SYMBOL("LambdaHelperPtr"));
+            duk_push_pointer(ctxRawPtr, (void *) this);
+            duk_put_prop_string(ctxRawPtr, -2, DUK_HIDDEN_SYMBOL("EnginePtr"));
+            duk_set_finalizer(ctxRawPtr, -2);
 
-                // Pop back both the pointer and the "current function"
-                duk_pop_2(ctx);
+            // And hang on to it!
+            persistentReleasePool[helper->id] = std::move(helper);
+        }
 
-                // Now we can collect our args
-                std::vector<juce::var> args;
-                int nargs = duk_get_top(ctx);
+        /** Pushes a wrapper function for the given native function, held in a free slot of
+         *  the temporary callback slab. Returns false if every slot a magic value can
+         *  index is in use.
+         *
+         *  The wrapper shares a single finalizer with every other temporary, so pushing
+         *  one costs no native allocations once the slab has grown to its working size.
+         */
+        bool pushTemporaryNativeFunction (juce::var::NativeFunction fn)
+        {
+            int index = firstFreeTemporaryCallback;
 
-                for (int i = 0; i < nargs; ++i)
-                    args.push_back(engine->readVarFromDukStack(engine->dukContext, i));
+            if (index >= 0)
+            {
+                firstFreeTemporaryCallback = temporaryCallbacks[static_cast<size_t>(index)].nextFree;
+            }
+            else
+            {
+                if (temporaryCallbacks.size() > static_cast<size_t>(std::numeric_limits<duk_int16_t>::max()))
+                    return false;
 
-                juce::var result;
+                index = static_cast<int>(temporaryCallbacks.size());
+                temporaryCallbacks.emplace_back();
+            }
 
-                // Now we can invoke the user method with its arguments
-                try
-                {
-                    result = std::invoke(helper->callback, juce::var::NativeFunctionArgs(
-                        juce::var(),
-                        args.data(),
-                        static_cast<int>(args.size())
-                    ));
-                }
-                catch (Error& err)
-                {
-                    duk_push_error_object(ctx, DUK_ERR_TYPE_ERROR, err.what());
-                    return duk_throw(ctx);
-                }
+            auto& slot = temporaryCallbacks[static_cast<size_t>(index)];
+            slot.callback = std::move(fn);
+            slot.nextFree = -1;
 
-                // For an undefined result, return 0 to notify the duktape interpreter
-                if (result.isUndefined())
-                    return 0;
+            auto* ctxRawPtr = dukContext.get();
 
-                // Otherwise, push the result to the stack and tell duktape
-                engine->pushVarToDukStack(engine->dukContext, result);
-                return 1;
-            }
+            duk_push_c_function(ctxRawPtr, TemporaryCallback::invokeFromDukContext, DUK_VARARGS);
+            duk_set_magic(ctxRawPtr, -1, index);
+            duk_push_heapptr(ctxRawPtr, temporaryCallbackFinalizer);
+            duk_set_finalizer(ctxRawPtr, -2);
 
-            static duk_ret_t invokeFromDukContextLightFunc(duk_context* ctx)
-            {
-                // Retrieve the engine pointer
-                duk_push_global_stash(ctx);
-                duk_get_prop_string(ctx, -1, DUK_HIDDEN_SYMBOL("__EcmascriptEngineInstance__"));
+            return true;
+        }
 
-                auto* engine = static_cast<EcmascriptEngine::Pimpl*>(duk_get_pointer(ctx, -1));
-                duk_pop_2(ctx);
+        void releaseTemporaryCallback (int index)
+        {
+            auto& slot = temporaryCallbacks[static_cast<size_t>(index)];
+            slot.callback = nullptr;
+            slot.nextFree = firstFreeTemporaryCallback;
+            firstFreeTemporaryCallback = index;
+        }
 
-                // Retrieve the lambda helper
-                duk_push_current_function(ctx);
-                const auto magic = duk_get_magic(ctx, -1);
-                auto& helper = engine->temporaryReleasePool[static_cast<size_t> (magic + 128)];
-                duk_pop(ctx);
+        /** Collects the arguments on the duktape stack, invokes the given native function
+         *  with them and pushes its result, if any.
+         */
+        static duk_ret_t invokeNativeFunction (Pimpl& engine, duk_context* ctx, const juce::var::NativeFunction& fn)
+        {
+            const auto nargs = duk_get_top(ctx);
+            std::vector<juce::var> args;
+            args.reserve(static_cast<size_t> (nargs));
 
-                // Now we can collect our args
-                const auto nargs = duk_get_top(ctx);
-                std::vector<juce::var> args;
-                args.reserve(static_cast<size_t> (nargs));
+            for (int i = 0; i < nargs; ++i)
+                args.push_back(engine.readVarFromDukStack(engine.dukContext, i));
 
-                for (int i = 0; i < nargs; ++i)
-                    args.push_back(engine->readVarFromDukStack(engine->dukContext, i));
+            juce::var result;
 
-                // Now we can invoke the user method with its arguments
-                const auto result = std::invoke(helper->callback, juce::var::NativeFunctionArgs(
+            // Now we can invoke the user method with its arguments
+            try
+            {
+                result = std::invoke(fn, juce::var::NativeFunctionArgs(
                     juce::var(),
                     args.data(),
                     static_cast<int>(args.size())
                 ));
-
-                // For an undefined result, return 0 to notify the duktape interpreter
-                if (result.isUndefined())
-                    return 0;
-
-                // Otherwise, push the result to the stack and tell duktape
-                engine->pushVarToDukStack(engine->dukContext, result);
-                return 1;
             }
-
-            static duk_ret_t callbackFinalizer (duk_context* ctx)
+            catch (Error& err)
             {
-                // First we have to retrieve the actual function pointer and our engine pointer
-                // See: https://duktape.org/guide.html#hidden-symbol-properties
-                // And: https://duktape.org/api.html#duk_set_finalizer
-                // In this case our function is at index 0.
-                duk_require_function(ctx, 0);
-                duk_get_prop_string(ctx, 0, DUK_HIDDEN_SYMBOL("LambdaHelperPtr"));
-
-                LambdaHelper* helper = static_cast<LambdaHelper*>(duk_get_pointer(ctx, -1));
-                duk_pop(ctx);
-
-                // Then the engine...
-                duk_get_prop_string(ctx, 0, DUK_HIDDEN_SYMBOL("EnginePtr"));
-                auto* engine = static_cast<EcmascriptEngine::Pimpl*>(duk_get_pointer(ctx, -1));
-
-                // Pop back both the pointer and the "current function"
-                duk_pop_2(ctx);
+                duk_push_error_object(ctx, DUK_ERR_TYPE_ERROR, "%s", err.what());
+                return duk_throw(ctx);
+            }
 
-                // Clean up our lambda helper
-                engine->removeLambdaHelper(helper);
+            // For an undefined result, return 0 to notify the duktape interpreter
+            if (result.isUndefined())
                 return 0;
-            }
 
-            juce::var::NativeFunction callback;
-            uint32_t id;
-        };
+            // Otherwise, push the result to the stack and tell duktape
+            engine.pushVarToDukStack(engine.dukContext, result);
+            return 1;
+        }
 
-        //==============================================================================
         /** Helper for cleaning up native function temporaries. */
         void removeLambdaHelper (LambdaHelper* helper)
         {
@@ -554,6 +1295,24 @@ namespace reactjuce
                 return duk_push_number(ctxRawPtr, (double) v);
             if (v.isString())
                 return (void) duk_push_string(ctxRawPtr, v.toString().toRawUTF8());
+            if (v.isBinaryData())
+            {
+                // Binary data arrives in JS as an ArrayBuffer, which callers may wrap in
+                // whichever typed array view suits the payload. We can't point the buffer
+                // at the var's own storage because nothing ties its lifetime to the JS
+                // object, so we copy it once into a heap owned buffer instead.
+                const auto* block = v.getBinaryData();
+                const auto size = static_cast<duk_size_t>(block->getSize());
+
+                auto* data = duk_push_fixed_buffer(ctxRawPtr, size);
+
+                if (size > 0)
+                    std::memcpy(data, block->getData(), size);
+
+                duk_push_buffer_object(ctxRawPtr, -1, 0, size, DUK_BUFOBJ_ARRAYBUFFER);
+                duk_remove(ctxRawPtr, -2);
+                return;
+            }
             if (v.isArray())
             {
                 duk_idx_t arr_idx = duk_push_array(ctxRawPtr);
@@ -575,8 +1334,9 @@ namespace reactjuce
 
                     for (auto& e : o->getProperties())
                     {
+                        pushPropertyKey(e.name);
                         pushVarToDukStack(ctx, e.value, persistNativeFunctions);
-                        duk_put_prop_string(ctxRawPtr, obj_idx, e.name.toString().toRawUTF8());
+                        duk_put_prop(ctxRawPtr, obj_idx);
                     }
                 }
 
@@ -584,48 +1344,13 @@ namespace reactjuce
             }
             if (v.isMethod())
             {
-                if (persistNativeFunctions)
-                {
-                    // For persisted native functions, we provide a helper layer storing and retrieving the
-                    // stash, and marshalling between the Duktape C interface and the NativeFunction interface
-                    duk_push_c_function(ctxRawPtr, LambdaHelper::invokeFromDukContext, DUK_VARARGS);
-
-                    // Now we assign the pointers as properties of the wrapper function
-                    auto helper = std::make_unique<LambdaHelper>(v.getNativeFunction(), nextHelperId++);
-                    duk_push_pointer(ctxRawPtr, (void *) helper.get());
-                    duk_put_prop_string(ctxRawPtr, -2, DUK_HIDDEN_SYMBOL("LambdaHelperPtr"));
-                    duk_push_pointer(ctxRawPtr, (void *) this);
-                    duk_put_prop_string(ctxRawPtr, -2, DUK_HIDDEN_SYMBOL("EnginePtr"));
-
-                    // Now we prepare the finalizer
-                    duk_push_c_function(ctxRawPtr, LambdaHelper::callbackFinalizer, 1);
-                    duk_push_pointer(ctxRawPtr, (void *) helper.get());
-                    duk_put_prop_string(ctxRawPtr, -2, DUK_HIDDEN_SYMBOL("LambdaHelperPtr"));
-                    duk_push_pointer(ctxRawPtr, (void *) this);
-                    duk_put_prop_string(ctxRawPtr, -2, DUK_HIDDEN_SYMBOL("EnginePtr"));
-                    duk_set_finalizer(ctxRawPtr, -2);
-
-                    // And hang on to it!
-                    persistentReleasePool[helper->id] = std::move(helper);
-                }
-                else
-                {
-                    // For temporary native functions, we use the stack-allocated lightfunc. In
-                    // this case we can't attach properties, so we can't rely on raw pointers to
-                    // the LambdaHelper and we can't rely on finalizers. So, all we do here is use
-                    // a small pool for temporary LambdaHelpers. Within this pool, we just allow insertions
-                    // to wrap around and clobber previous temporaries, effectively garbage collecting on
-                    // demand. The maximum number of temporary values before wrapping is 255, as dictated
-                    // by that we use the lightfunc's magic number to identify our native callback.
-                    auto helper = std::make_unique<LambdaHelper>(v.getNativeFunction(), nextHelperId++);
-                    auto magic = nextMagicInt++;
-
-                    duk_push_c_lightfunc(ctxRawPtr, LambdaHelper::invokeFromDukContextLightFunc, DUK_VARARGS, 15, magic);
-                    temporaryReleasePool[static_cast<size_t> (magic + 128)] = std::move(helper);
-
-                    if (nextMagicInt >= 127)
-                        nextMagicInt = -128;
-                }
+                // Temporary native functions are held in a growable slab indexed by the magic
+                // value of their wrapper function, and released by its finalizer once the
+                // function becomes unreachable. Only in the unlikely event that more temporaries
+                // are alive than a magic value can index do we fall back to the persistent path.
+                if (persistNativeFunctions || !pushTemporaryNativeFunction(v.getNativeFunction()))
+                    pushPersistentNativeFunction(v.getNativeFunction());
+
                 return;
             }
 
@@ -658,9 +1383,21 @@ namespace reactjuce
                 case DUK_TYPE_STRING:
                     value = juce::String(juce::CharPointer_UTF8(duk_get_string(ctxRawPtr, idx)));
                     break;
+                case DUK_TYPE_BUFFER:
                 case DUK_TYPE_OBJECT:
                 case DUK_TYPE_LIGHTFUNC:
                 {
+                    // Plain buffers, ArrayBuffers and typed array views all read back as
+                    // binary data, copied in one go from the range the view covers.
+                    if (duk_is_buffer_data(ctxRawPtr, idx))
+                    {
+                        duk_size_t size = 0;
+                        const auto* data = duk_get_buffer_data(ctxRawPtr, idx, &size);
+
+                        value = juce::MemoryBlock(data, static_cast<size_t>(size));
+                        break;
+                    }
+
                     if (duk_is_array(ctxRawPtr, idx))
                     {
                         duk_size_t len = duk_get_length(ctxRawPtr, idx);
@@ -679,50 +1416,47 @@ namespace reactjuce
 
                     if (duk_is_function(ctxRawPtr, idx) || duk_is_lightfunc(ctxRawPtr, idx))
                     {
+                        // Releases the callback's slot in the callback table once the last copy
+                        // of the var::NativeFunction wrapping it is gone. If the context has been
+                        // reset or destroyed in the meantime, its slot went with it.
                         struct CallbackHelper {
-                            CallbackHelper(std::weak_ptr<duk_context> _weakContext)
-                                : weakContext(_weakContext)
-                                , funcId(juce::String("__NativeCallback__") + juce::Uuid().toString()) {}
+                            CallbackHelper(Pimpl& _engine, std::weak_ptr<duk_context> _weakContext, CallbackSlotHandle _slot)
+                                : engine(_engine)
+                                , weakContext(_weakContext)
+                                , slot(_slot) {}
 
                             ~CallbackHelper() {
-                                if (auto spt = weakContext.lock()) {
-                                    duk_push_global_stash(spt.get());
-                                    duk_del_prop_string(spt.get(), -1, funcId.toRawUTF8());
-                                    duk_pop(spt.get());
-                                }
+                                // The engine owns the only lasting reference to its context,
+                                // so `engine` may only be touched while the context is alive;
+                                // the var may well outlive both
+                                if (auto spt = weakContext.lock(); spt != nullptr && spt == engine.dukContext)
+                                    engine.releaseCallbackSlot(slot);
                             }
 
+                            Pimpl& engine;
                             std::weak_ptr<duk_context> weakContext;
-                            juce::String funcId;
+                            CallbackSlotHandle slot;
                         };
 
-                        // With a function, we first push the function reference to
-                        // the Duktape global stash so we can read it later.
-                        auto helper = std::make_shared<CallbackHelper>(ctx);
+                        // With a function, we first store the function reference in a slot
+                        // of the callback table so we can read it later.
+                        auto helper = std::make_shared<CallbackHelper>(*this, ctx, acquireCallbackSlot(idx));
 
-                        duk_push_global_stash(ctxRawPtr);
-                        duk_dup(ctxRawPtr, idx);
-                        duk_put_prop_string(ctxRawPtr, -2, helper->funcId.toRawUTF8());
-                        duk_pop(ctxRawPtr);
-
-                        // Next we create a var::NativeFunction that captures the function
-                        // id and knows how to invoke it
+                        // Next we create a var::NativeFunction that captures the slot
+                        // and knows how to invoke it
                         value = juce::var::NativeFunction {
-                            [this, weakContext = std::weak_ptr<duk_context>(ctx), helper](const juce::var::NativeFunctionArgs& args) -> juce::var {
-                                auto sharedContext = weakContext.lock();
+                            [this, helper](const juce::var::NativeFunctionArgs& args) -> juce::var {
+                                auto sharedContext = helper->weakContext.lock();
 
-                                // If our context disappeared, we return early
-                                if (!sharedContext)
+                                // If our context disappeared or was replaced, we return early
+                                if (!sharedContext || sharedContext != dukContext)
                                     return juce::var();
 
                                 auto* rawPtr = sharedContext.get();
 
                                 // Here when we're being invoked we retrieve the callback function from
-                                // the global stash and invoke it with the provided args.
-                                duk_push_global_stash(rawPtr);
-                                duk_get_prop_string(rawPtr, -1, helper->funcId.toRawUTF8());
-
-                                if (!(duk_is_lightfunc(rawPtr, -1) || duk_is_function(rawPtr, -1)))
+                                // the callback table and invoke it with the provided args.
+                                if (!pushCallbackFromSlot(helper->slot))
                                     throw Error("Global callback not found.", "", detail::getContextDump(rawPtr));
 
                                 // Push the args to the duktape stack
@@ -733,15 +1467,16 @@ namespace reactjuce
 
                                 // Invocation
                                 try {
+                                    detail::ExecutionBudget::Scope budgetScope (executionBudget);
                                     detail::safeCall(rawPtr, args.numArguments);
                                 } catch (Error const& err) {
                                     reset();
                                     throw err;
                                 }
 
-                                // Clean the result and the stash off the top of the stack
+                                // Clean the result off the top of the stack
                                 juce::var result = readVarFromDukStack(sharedContext, -1);
-                                duk_pop_2(rawPtr);
+                                duk_pop(rawPtr);
 
                                 return result;
                             }
@@ -768,7 +1503,7 @@ namespace reactjuce
                         // conversion from number to string. Thus here, while constructing
                         // the DynamicObject, we take the `toString()` value for the key
                         // always.
-                        obj->setProperty(duk_to_string(ctxRawPtr, -2), readVarFromDukStack(ctx, -1));
+                        obj->setProperty(readPropertyKey(-2), readVarFromDukStack(ctx, -1));
 
                         // Clear the key/value pair from the stack
                         duk_pop_2(ctxRawPtr);
@@ -789,11 +1524,340 @@ namespace reactjuce
         }
 
         //==============================================================================
+        /** Identifies a JavaScript function held in the callback table. The generation
+         *  distinguishes successive occupants of the same slot.
+         */
+        struct CallbackSlotHandle
+        {
+            int          index      = -1;
+            juce::uint32 generation = 0;
+        };
+
+        /** Stores the function at the given stack index in a free slot of the callback
+         *  table, growing the table only when no released slot is available for reuse.
+         */
+        CallbackSlotHandle acquireCallbackSlot (duk_idx_t idx)
+        {
+            auto* ctxRawPtr = dukContext.get();
+            idx = duk_normalize_index(ctxRawPtr, idx);
+
+            int index = firstFreeCallbackSlot;
+
+            if (index >= 0)
+            {
+                firstFreeCallbackSlot = callbackSlots[static_cast<size_t>(index)].nextFree;
+            }
+            else
+            {
+                index = static_cast<int>(callbackSlots.size());
+                callbackSlots.emplace_back();
+            }
+
+            auto& slot = callbackSlots[static_cast<size_t>(index)];
+            slot.nextFree = -1;
+
+            duk_push_heapptr(ctxRawPtr, callbackTable);
+            duk_dup(ctxRawPtr, idx);
+            duk_put_prop_index(ctxRawPtr, -2, static_cast<duk_uarridx_t>(index));
+            duk_pop(ctxRawPtr);
+
+            return { index, slot.generation };
+        }
+
+        /** Clears the given slot, releasing its function to the garbage collector and
+         *  returning the slot to the free list.
+         */
+        void releaseCallbackSlot (const CallbackSlotHandle& handle)
+        {
+            if (!isValidCallbackSlot(handle))
+                return;
+
+            auto* ctxRawPtr = dukContext.get();
+            auto& slot = callbackSlots[static_cast<size_t>(handle.index)];
+
+            duk_push_heapptr(ctxRawPtr, callbackTable);
+            duk_push_undefined(ctxRawPtr);
+            duk_put_prop_index(ctxRawPtr, -2, static_cast<duk_uarridx_t>(handle.index));
+            duk_pop(ctxRawPtr);
+
+            ++slot.generation;
+            slot.nextFree = firstFreeCallbackSlot;
+            firstFreeCallbackSlot = handle.index;
+        }
+
+        /** Pushes the function held in the given slot, returning false if the handle
+         *  no longer refers to a live slot.
+         */
+        bool pushCallbackFromSlot (const CallbackSlotHandle& handle)
+        {
+            if (!isValidCallbackSlot(handle))
+                return false;
+
+            auto* ctxRawPtr = dukContext.get();
+
+            duk_push_heapptr(ctxRawPtr, callbackTable);
+            duk_get_prop_index(ctxRawPtr, -1, static_cast<duk_uarridx_t>(handle.index));
+            duk_remove(ctxRawPtr, -2);
+
+            if (duk_is_function(ctxRawPtr, -1) || duk_is_lightfunc(ctxRawPtr, -1))
+                return true;
+
+            duk_pop(ctxRawPtr);
+            return false;
+        }
+
+        bool isValidCallbackSlot (const CallbackSlotHandle& handle) const
+        {
+            return juce::isPositiveAndBelow(handle.index, static_cast<int>(callbackSlots.size()))
+                && callbackSlots[static_cast<size_t>(handle.index)].generation == handle.generation;
+        }
+
+        //==============================================================================
+        /** Pushes the given object key to the top of the duktape stack, reusing the
+         *  heap string interned for it the last time it crossed the bridge.
+         */
+        void pushPropertyKey (const juce::Identifier& name)
+        {
+            auto* ctxRawPtr = dukContext.get();
+
+            if (auto it = keysByIdentifier.find(name.getCharPointer().getAddress()); it != keysByIdentifier.end())
+                return (void) duk_push_heapptr(ctxRawPtr, it->second);
+
+            const auto s = name.toString();
+            duk_push_lstring(ctxRawPtr, s.toRawUTF8(), s.getNumBytesAsUTF8());
+
+            if (auto* key = internPropertyKey(-1))
+            {
+                keysByIdentifier.emplace(name.getCharPointer().getAddress(), key);
+                identifiersByKey.emplace(key, name);
+            }
+        }
+
+        /** Returns the Identifier for the object key at the given stack index, skipping
+         *  the string conversion and Identifier pool lookup for keys we've seen before.
+         */
+        juce::Identifier readPropertyKey (duk_idx_t idx)
+        {
+            auto* ctxRawPtr = dukContext.get();
+
+            if (duk_is_string(ctxRawPtr, idx))
+                if (auto it = identifiersByKey.find(duk_get_heapptr(ctxRawPtr, idx)); it != identifiersByKey.end())
+                    return it->second;
+
+            juce::Identifier name (juce::String(juce::CharPointer_UTF8(duk_to_string(ctxRawPtr, idx))));
+
+            if (auto* key = internPropertyKey(idx))
+            {
+                keysByIdentifier.emplace(name.getCharPointer().getAddress(), key);
+                identifiersByKey.emplace(key, name);
+            }
+
+            return name;
+        }
+
+        /** Pins the string at the given stack index in the property key table so that its
+         *  heap pointer stays valid, or returns nullptr if the table is full.
+         *
+         *  The table is bounded so that objects used as maps with arbitrary keys can't
+         *  grow it without limit; keys beyond that take the uncached path.
+         */
+        void* internPropertyKey (duk_idx_t idx)
+        {
+            if (identifiersByKey.size() >= maxNumPropertyKeys)
+                return nullptr;
+
+            auto* ctxRawPtr = dukContext.get();
+            idx = duk_normalize_index(ctxRawPtr, idx);
+
+            duk_push_global_stash(ctxRawPtr);
+            duk_get_prop_string(ctxRawPtr, -1, DUK_HIDDEN_SYMBOL("__PropertyKeys__"));
+            duk_dup(ctxRawPtr, idx);
+            duk_put_prop_index(ctxRawPtr, -2, static_cast<duk_uarridx_t>(identifiersByKey.size()));
+            duk_pop_2(ctxRawPtr);
+
+            return duk_get_heapptr(ctxRawPtr, idx);
+        }
+
+        //==============================================================================
+        MemoryStats getMemoryStats() const
+        {
+            return heapAllocator.getStats();
+        }
+
+        void collectGarbage()
+        {
+            duk_gc(dukContext.get(), 0);
+        }
+
+        //==============================================================================
+        void startProfiling (double sampleIntervalMs)
+        {
+            profiler = std::make_unique<detail::ProfileRecorder>(sampleIntervalMs);
+        }
+
+        Profile stopProfiling()
+        {
+            if (profiler == nullptr)
+                return {};
+
+            auto profile = profiler->finish();
+            profiler.reset();
+
+            return profile;
+        }
+
+        bool isProfiling() const
+        {
+            return profiler != nullptr;
+        }
+
+        //==============================================================================
+        void setExecutionBudget (double budgetMs)
+        {
+            executionBudget.setLimit(budgetMs);
+        }
+
+        double getExecutionBudget() const
+        {
+            return executionBudget.getLimit();
+        }
+
+        ExecutionStats getExecutionStats() const
+        {
+            return executionBudget.getStats();
+        }
+
+        //==============================================================================
+        /** Called by the executor every few hundred thousand instructions. Returning
+         *  true throws a RangeError, and the executor calls again after the next
+         *  instruction, so an overrun call keeps throwing until it has unwound.
+         */
+        static bool handleInterrupt (void* udata)
+        {
+            auto* engine = static_cast<Pimpl*>(udata);
+
+            if (engine->profiler != nullptr)
+            {
+                const auto now = juce::Time::getMillisecondCounterHiRes();
+
+                if (engine->profiler->isSampleDue(now))
+                    engine->sampleCallStack(now);
+            }
+
+            return engine->executionBudget.hasExpired();
+        }
+
+        /** Records the call stack of the running thread.
+         *
+         *  We're called from within the executor, where the value stack mustn't be
+         *  touched, so we read the activation records directly and only ever look up
+         *  own data properties, which neither allocate nor run any code.
+         */
+        void sampleCallStack (double now)
+        {
+            auto* thr = reinterpret_cast<duk_hthread*>(dukContext.get())->heap->curr_thread;
+
+            if (thr == nullptr)
+                return;
+
+            std::vector<int> stack;
+
+            for (auto* act = thr->callstack_curr; act != nullptr; act = act->parent)
+            {
+                auto* func = DUK_ACT_GET_FUNC(act);
+
+                if (func == nullptr)
+                    continue;
+
+                auto functionName = getOwnStringProperty(thr->heap, func, DUK_STRIDX_NAME);
+                int lineNumber = 0;
+
+                if (DUK_HOBJECT_IS_COMPFUNC(func))
+                {
+                    auto* pc2line = duk_hobject_find_entry_tval_ptr_stridx(thr->heap, func, DUK_STRIDX_INT_PC2LINE);
+
+                    if (pc2line != nullptr && DUK_TVAL_IS_BUFFER(pc2line))
+                        lineNumber = static_cast<int>(duk__hobject_pc2line_query_raw(thr,
+                                                                                     reinterpret_cast<duk_hbuffer_fixed*>(DUK_TVAL_GET_BUFFER(pc2line)),
+                                                                                     duk_hthread_get_act_prev_pc(thr, act)));
+                }
+                else if (functionName.empty())
+                {
+                    functionName = "(native)";
+                }
+
+                stack.push_back(profiler->getFrameIndex(functionName, getOwnStringProperty(thr->heap, func, DUK_STRIDX_FILE_NAME), lineNumber));
+            }
+
+            std::reverse(stack.begin(), stack.end());
+            profiler->addSample(now, std::move(stack));
+        }
+
+        static std::string getOwnStringProperty (duk_heap* heap, duk_hobject* obj, duk_small_uint_t stridx)
+        {
+            auto* tv = duk_hobject_find_entry_tval_ptr_stridx(heap, obj, stridx);
+
+            if (tv == nullptr || !DUK_TVAL_IS_STRING(tv))
+                return {};
+
+            auto* str = DUK_TVAL_GET_STRING(tv);
+            return std::string(reinterpret_cast<const char*>(DUK_HSTRING_GET_DATA(str)), static_cast<size_t>(DUK_HSTRING_GET_BYTELEN(str)));
+        }
+
+        //==============================================================================
+        // The heap's user data points back at this engine, which owns the allocator.
+        static void* allocFunction (void* udata, duk_size_t size)
+        {
+            return static_cast<Pimpl*>(udata)->heapAllocator.allocate(static_cast<size_t>(size));
+        }
+
+        static void* reallocFunction (void* udata, void* ptr, duk_size_t size)
+        {
+            return static_cast<Pimpl*>(udata)->heapAllocator.reallocate(ptr, static_cast<size_t>(size));
+        }
+
+        static void freeFunction (void* udata, void* ptr)
+        {
+            static_cast<Pimpl*>(udata)->heapAllocator.free(ptr);
+        }
+
+        //==============================================================================
+        // The allocator must outlive every heap it serves, so it's listed first and
+        // destructed after the duk_context below.
+        detail::HeapAllocator heapAllocator;
+
+        juce::uint32 generation = 0;
+        int numResolvedFunctions = 0;
+
+        // The table of JavaScript functions handed to native code, and a free list of its
+        // released slots threaded through `nextFree`.
+        struct CallbackSlot
+        {
+            juce::uint32 generation = 0;
+            int          nextFree   = -1;
+        };
+
+        std::vector<CallbackSlot> callbackSlots;
+        int firstFreeCallbackSlot = -1;
+        void* callbackTable = nullptr;
+
+        // Interned object keys in both directions. Identifiers are pooled, so the address
+        // of an identifier's characters identifies it for as long as our copy keeps it alive.
+        static constexpr size_t maxNumPropertyKeys = 1024;
+        std::unordered_map<const char*, void*> keysByIdentifier;
+        std::unordered_map<void*, juce::Identifier> identifiersByKey;
+
         uint32_t nextHelperId = 0;
-        int32_t nextMagicInt = 0;
         std::unordered_map<uint32_t, std::unique_ptr<LambdaHelper>> persistentReleasePool;
-        std::array<std::unique_ptr<LambdaHelper>, 255> temporaryReleasePool;
+        std::deque<TypedFunctionHelper> typedFunctionPool;
+        std::deque<TemporaryCallback> temporaryCallbacks;
+        int firstFreeTemporaryCallback = -1;
+        void* temporaryCallbackFinalizer = nullptr;
+        void* runTimersFunction = nullptr;
         std::unique_ptr<TimeoutFunctionManager> timeoutsManager;
+        CallbackDispatcher callbackDispatcher;
+        std::unique_ptr<detail::ProfileRecorder> profiler;
+        detail::ExecutionBudget executionBudget;
 
         // The duk_context must be listed after the release pools so that it is destructed
         // before the pools. That way, as the duk_context is being freed and finalizing all
@@ -21,6 +21,8 @@
 #pragma GCC diagnostic pop
 #endif
 
+#include <forward_list>
+
 using namespace facebook;
 
 namespace reactjuce
@@ -49,6 +51,37 @@ namespace reactjuce
             std::unique_ptr<juce::MemoryBlock> memBlock;
         };
 
+        //==============================================================================
+        /** Bytecode which Hermes runs in place, such as a memory mapped file or static
+         *  BinaryData, so that only the pages which actually execute are ever loaded.
+         *
+         *  Holds on to whatever owns the memory for as long as a runtime may read it.
+         */
+        class JSIExternalBuffer : public jsi::Buffer
+        {
+        public:
+            JSIExternalBuffer(std::shared_ptr<const void> memOwner, const void *memData, size_t memSize)
+                : owner(std::move(memOwner))
+                , bytes(static_cast<const uint8_t*>(memData))
+                , numBytes(memSize)
+            { }
+
+            size_t size() const override
+            {
+                return numBytes;
+            }
+
+            const uint8_t *data() const override
+            {
+                return bytes;
+            }
+
+        private:
+            std::shared_ptr<const void> owner;
+            const uint8_t              *bytes;
+            size_t                      numBytes;
+        };
+
         //==============================================================================
         struct CopyableJSIMethodWrapper
         {
@@ -60,64 +93,169 @@ namespace reactjuce
         };
 
         //==============================================================================
-        juce::var  jsiValueToVar(const jsi::Value &v, jsi::Runtime &runtime);
-        jsi::Value varToJSIValue(const juce::var &v, jsi::Runtime &runtime);
+        /** Caches the property keys seen while marshalling objects, so that objects
+         *  with the same shape crossing the bridge repeatedly reuse one PropNameID and
+         *  one juce::Identifier per key instead of recreating both for every object.
+         *
+         *  The table is bounded, after which unseen keys take the uncached path, so that
+         *  objects used as maps with arbitrary keys can't grow it without limit.
+         */
+        class PropertyKeyTable
+        {
+        public:
+            struct Key
+            {
+                juce::Identifier identifier;
+                jsi::PropNameID  propName;
+            };
+
+            /** Returns the cached key for the given identifier, or nullptr if the table is full. */
+            const Key* lookup(jsi::Runtime &runtime, const juce::Identifier &identifier)
+            {
+                if (auto it = keysByIdentifier.find(identifier.getCharPointer().getAddress()); it != keysByIdentifier.end())
+                    return it->second;
 
-        juce::var jsiArrayToVarArray(const jsi::Array &v, jsi::Runtime &runtime)
+                return add(runtime, identifier, identifier.toString().toStdString());
+            }
+
+            /** Returns the cached key for the given UTF-8 name, or nullptr if the table is full. */
+            const Key* lookup(jsi::Runtime &runtime, const std::string &name)
+            {
+                if (auto it = keysByName.find(name); it != keysByName.end())
+                    return it->second;
+
+                if (name.empty())
+                    return nullptr;
+
+                return add(runtime, juce::Identifier(juce::String::fromUTF8(name.data(), static_cast<int>(name.size()))), name);
+            }
+
+            /** Releases every cached key. Must be called before the owning runtime is destroyed. */
+            void clear()
+            {
+                keysByIdentifier.clear();
+                keysByName.clear();
+                keys.clear();
+            }
+
+        private:
+            const Key* add(jsi::Runtime &runtime, const juce::Identifier &identifier, const std::string &name)
+            {
+                if (keys.size() >= maxNumKeys)
+                    return nullptr;
+
+                keys.push_back({ identifier, jsi::PropNameID::forUtf8(runtime, name) });
+
+                auto* key = &keys.back();
+                keysByIdentifier.emplace(key->identifier.getCharPointer().getAddress(), key);
+                keysByName.emplace(name, key);
+
+                return key;
+            }
+
+            static constexpr size_t maxNumKeys = 1024;
+
+            // Identifiers are pooled, so the address of an identifier's characters
+            // identifies it for as long as our copy in the key keeps it alive.
+            std::deque<Key>                                 keys;
+            std::unordered_map<const char*, const Key*>     keysByIdentifier;
+            std::unordered_map<std::string, const Key*>     keysByName;
+        };
+
+        //==============================================================================
+        juce::var  jsiValueToVar(const jsi::Value &v, jsi::Runtime &runtime, PropertyKeyTable &keys);
+        jsi::Value varToJSIValue(const juce::var &v, jsi::Runtime &runtime, PropertyKeyTable &keys);
+
+        juce::String jsiStringToString(const jsi::String &s, jsi::Runtime &runtime)
         {
-            juce::Array<juce::var> varArray;
+            const auto utf8 = s.utf8(runtime);
+            return juce::String::fromUTF8(utf8.data(), static_cast<int>(utf8.size()));
+        }
+
+        jsi::String stringToJSIString(const juce::String &s, jsi::Runtime &runtime)
+        {
+            return jsi::String::createFromUtf8(runtime,
+                                               reinterpret_cast<const uint8_t*>(s.toRawUTF8()),
+                                               s.getNumBytesAsUTF8());
+        }
 
+        juce::var jsiArrayToVarArray(const jsi::Array &v, jsi::Runtime &runtime, PropertyKeyTable &keys)
+        {
             const size_t numItems = v.size(runtime);
+
+            juce::Array<juce::var> varArray;
+            varArray.ensureStorageAllocated(static_cast<int>(numItems));
+
             for (size_t i = 0; i < numItems; ++i)
             {
-                varArray.add(jsiValueToVar(v.getValueAtIndex(runtime, i), runtime));
+                const jsi::Value item = v.getValueAtIndex(runtime, i);
+
+                // Numbers make up most arrays crossing the bridge, such as canvas
+                // commands, so they skip the general conversion
+                if (item.isNumber())
+                    varArray.add(item.getNumber());
+                else
+                    varArray.add(jsiValueToVar(item, runtime, keys));
             }
 
             return varArray;
         }
 
-        juce::var::NativeFunction jsiMethodToVarMethod(jsi::Function v, jsi::Runtime &runtime)
+        juce::var::NativeFunction jsiMethodToVarMethod(jsi::Function v, jsi::Runtime &runtime, PropertyKeyTable &keys)
         {
             auto fPtr = std::make_shared<CopyableJSIMethodWrapper>(std::move(v));
 
-            return [fPtr = fPtr, &rt = runtime] (const juce::var::NativeFunctionArgs &args)
+            return [fPtr = fPtr, &rt = runtime, &keys] (const juce::var::NativeFunctionArgs &args)
             {
                 std::vector<jsi::Value> jsiArgs;
+                jsiArgs.reserve(static_cast<size_t>(args.numArguments));
+
                 for (int i = 0; i < args.numArguments; ++i)
                 {
-                    jsiArgs.emplace_back(varToJSIValue(args.arguments[i], rt));
+                    jsiArgs.emplace_back(varToJSIValue(args.arguments[i], rt, keys));
                 }
 
                 const jsi::Value *jsiArgsPtr = jsiArgs.data();
-                return jsiValueToVar(fPtr->fn.call(rt, jsiArgsPtr, jsiArgs.size()), rt);
+                return jsiValueToVar(fPtr->fn.call(rt, jsiArgsPtr, jsiArgs.size()), rt, keys);
             };
         }
 
-        juce::var jsiObjectToVarObject(const jsi::Object &v, jsi::Runtime &runtime)
+        juce::var jsiObjectToVarObject(const jsi::Object &v, jsi::Runtime &runtime, PropertyKeyTable &keys)
         {
             juce::DynamicObject::Ptr varObj = new juce::DynamicObject();
 
             jsi::Array props = v.getPropertyNames(runtime);
-            for (size_t i = 0; i < props.size(runtime); ++i)
+            const size_t numProps = props.size(runtime);
+
+            for (size_t i = 0; i < numProps; ++i)
             {
-                const juce::String propId = props.getValueAtIndex(runtime, i).asString(runtime).utf8(runtime);
-                jsi::Value property = v.getProperty(runtime, propId.toRawUTF8());
-                varObj->setProperty(propId, jsiValueToVar(property, runtime));
+                const auto propName = props.getValueAtIndex(runtime, i).asString(runtime).utf8(runtime);
+
+                if (auto* key = keys.lookup(runtime, propName))
+                {
+                    varObj->setProperty(key->identifier, jsiValueToVar(v.getProperty(runtime, key->propName), runtime, keys));
+                }
+                else
+                {
+                    const auto uncachedName = jsi::PropNameID::forUtf8(runtime, propName);
+                    varObj->setProperty(juce::String::fromUTF8(propName.data(), static_cast<int>(propName.size())),
+                                        jsiValueToVar(v.getProperty(runtime, uncachedName), runtime, keys));
+                }
             }
 
             return varObj.get();
         }
 
-        juce::var jsiValueToVar(const jsi::Value &v, jsi::Runtime &runtime)
+        juce::var jsiValueToVar(const jsi::Value &v, jsi::Runtime &runtime, PropertyKeyTable &keys)
         {
-            if (v.isBool())
-                return v.getBool();
-
             if (v.isNumber())
                 return v.getNumber();
 
+            if (v.isBool())
+                return v.getBool();
+
             if (v.isString())
-                return juce::String(v.getString(runtime).utf8(runtime));
+                return jsiStringToString(v.getString(runtime), runtime);
 
             if (v.isUndefined())
                 return juce::var::undefined();
@@ -130,7 +268,7 @@ namespace reactjuce
                 auto obj = v.getObject(runtime);
 
                 if (obj.isArray(runtime))
-                    return jsiArrayToVarArray(obj.getArray(runtime), runtime);
+                    return jsiArrayToVarArray(obj.getArray(runtime), runtime, keys);
 
                 if (obj.isArrayBuffer(runtime))
                 {
@@ -141,11 +279,34 @@ namespace reactjuce
                     return juce::var(memBlock);
                 }
 
+                // JSI has no typed array type, but every typed array view exposes its
+                // backing ArrayBuffer, so we copy the viewed range out of that rather
+                // than enumerating the view element by element.
+                if (obj.hasProperty(runtime, "buffer") && obj.hasProperty(runtime, "byteOffset"))
+                {
+                    jsi::Value buffer = obj.getProperty(runtime, "buffer");
+
+                    if (buffer.isObject() && buffer.getObject(runtime).isArrayBuffer(runtime))
+                    {
+                        jsi::ArrayBuffer arrayBuffer = buffer.getObject(runtime).getArrayBuffer(runtime);
+
+                        const auto byteOffset = static_cast<size_t>(obj.getProperty(runtime, "byteOffset").asNumber());
+                        const auto byteLength = static_cast<size_t>(obj.getProperty(runtime, "byteLength").asNumber());
+
+                        jassert(byteOffset + byteLength <= arrayBuffer.size(runtime));
+
+                        juce::MemoryBlock memBlock(static_cast<const void*>(arrayBuffer.data(runtime) + byteOffset),
+                                                   byteLength);
+
+                        return juce::var(memBlock);
+                    }
+                }
+
                 if (obj.isFunction(runtime))
-                    return jsiMethodToVarMethod(obj.asFunction(runtime), runtime);
+                    return jsiMethodToVarMethod(obj.asFunction(runtime), runtime, keys);
 
                 // If jsi object is not array or function type then treat as an object
-                return jsiObjectToVarObject(obj, runtime);
+                return jsiObjectToVarObject(obj, runtime, keys);
             }
 
             jassertfalse;
@@ -153,40 +314,52 @@ namespace reactjuce
         }
 
         //==============================================================================
-        jsi::Object varObjectToJSIObject(juce::DynamicObject *v, jsi::Runtime &runtime)
+        jsi::Object varObjectToJSIObject(juce::DynamicObject *v, jsi::Runtime &runtime, PropertyKeyTable &keys)
         {
             jassert(v);
 
             jsi::Object jsiObj(runtime);
             for (auto &prop : v->getProperties())
             {
-                jsiObj.setProperty(runtime, prop.name.getCharPointer(), varToJSIValue(prop.value, runtime));
+                auto value = varToJSIValue(prop.value, runtime, keys);
+
+                if (auto* key = keys.lookup(runtime, prop.name))
+                    jsiObj.setProperty(runtime, key->propName, std::move(value));
+                else
+                    jsiObj.setProperty(runtime, jsi::PropNameID::forUtf8(runtime, prop.name.toString().toStdString()), std::move(value));
             }
 
             return jsiObj;
         }
 
-        jsi::Function varMethodToJSIMethod(juce::var::NativeFunction &v, jsi::Runtime &runtime)
+        jsi::Function varMethodToJSIMethod(juce::var::NativeFunction &v, jsi::Runtime &runtime, PropertyKeyTable &keys)
         {
             return jsi::Function::createFromHostFunction(
                 runtime,
                 jsi::PropNameID::forAscii(runtime, ""),
                 0,
-                [v = v](jsi::Runtime& rt, const jsi::Value& thisVal, const jsi::Value* args, size_t count)
+                [v = v, &keys](jsi::Runtime& rt, const jsi::Value& thisVal, const jsi::Value* args, size_t count)
                 {
+                    // Converting `this` would copy the whole of whichever object the
+                    // function was called on, bindings object and all, on every call,
+                    // so like the Duktape backend we leave it undefined
+                    juce::ignoreUnused(thisVal);
+
                     std::vector<juce::var> varArgs;
+                    varArgs.reserve(count);
+
                     for (size_t i = 0; i < count; ++i)
                     {
-                        varArgs.push_back(jsiValueToVar(args[i], rt));
+                        varArgs.push_back(jsiValueToVar(args[i], rt, keys));
                     }
 
-                    juce::var::NativeFunctionArgs nfArgs(jsiValueToVar(thisVal, rt), varArgs.data(), static_cast<int>(count));
-                    return varToJSIValue(v(nfArgs), rt);
+                    juce::var::NativeFunctionArgs nfArgs(juce::var(), varArgs.data(), static_cast<int>(count));
+                    return varToJSIValue(v(nfArgs), rt, keys);
                 }
             );
         }
 
-        jsi::Array varArrayToJSIArray(const juce::Array<juce::var> *v, jsi::Runtime &runtime)
+        jsi::Array varArrayToJSIArray(const juce::Array<juce::var> *v, jsi::Runtime &runtime, PropertyKeyTable &keys)
         {
             jassert(v);
 
@@ -195,13 +368,38 @@ namespace reactjuce
 
             for (size_t i = 0; i < numItems; ++i)
             {
-                jsiArray.setValueAtIndex(runtime, i, varToJSIValue(v->getReference(static_cast<int>(i)), runtime));
+                const auto &item = v->getReference(static_cast<int>(i));
+
+                if (item.isDouble() || item.isInt())
+                    jsiArray.setValueAtIndex(runtime, i, static_cast<double>(item));
+                else
+                    jsiArray.setValueAtIndex(runtime, i, varToJSIValue(item, runtime, keys));
             }
 
             return jsiArray;
         }
 
-        jsi::Value varToJSIValue(const juce::var &v, jsi::Runtime &runtime)
+        jsi::ArrayBuffer varBinaryDataToJSIArrayBuffer(const juce::MemoryBlock *v, jsi::Runtime &runtime)
+        {
+            jassert(v);
+
+            // JSI offers no way to wrap native memory in an ArrayBuffer, so we have
+            // the runtime allocate one and copy the data into it in a single pass.
+            const auto size = v->getSize();
+
+            jsi::ArrayBuffer arrayBuffer = runtime.global()
+                                                  .getPropertyAsFunction(runtime, "ArrayBuffer")
+                                                  .callAsConstructor(runtime, static_cast<double>(size))
+                                                  .getObject(runtime)
+                                                  .getArrayBuffer(runtime);
+
+            if (size > 0)
+                std::memcpy(arrayBuffer.data(runtime), v->getData(), size);
+
+            return arrayBuffer;
+        }
+
+        jsi::Value varToJSIValue(const juce::var &v, jsi::Runtime &runtime, PropertyKeyTable &keys)
         {
             if (v.isBool())
                 return jsi::Value(static_cast<bool>(v));
@@ -216,7 +414,7 @@ namespace reactjuce
                 return jsi::Value(static_cast<double>(v));
 
             if (v.isString())
-                return jsi::Value(runtime,  jsi::String::createFromAscii(runtime, v.toString().getCharPointer()));
+                return stringToJSIString(v.toString(), runtime);
 
             if (v.isUndefined())
                 return jsi::Value::undefined();
@@ -225,39 +423,134 @@ namespace reactjuce
                 return {};
 
             if (v.isArray())
-                return varArrayToJSIArray(v.getArray(), runtime);
+                return varArrayToJSIArray(v.getArray(), runtime, keys);
 
             if (v.isMethod())
             {
                 auto nf = v.getNativeFunction();
-                return varMethodToJSIMethod(nf, runtime);
+                return varMethodToJSIMethod(nf, runtime, keys);
             }
 
             if (v.isObject())
-                return varObjectToJSIObject(v.getDynamicObject(), runtime);
+                return varObjectToJSIObject(v.getDynamicObject(), runtime, keys);
 
             if (v.isBinaryData())
-            {
-                //TODO: Currently appears no way to create a jsi::ArrayBuffer from C++.
-                jassertfalse;
-                return {};
-            }
+                return varBinaryDataToJSIArrayBuffer(v.getBinaryData(), runtime);
 
             jassertfalse;
             return {};
         }
 
+        //==============================================================================
+        /** The Hermes sampling profiler is shared by every runtime in the process, and
+         *  its trace mixes the samples of every runtime registered with it, with no
+         *  means of telling them apart. So only one engine may claim it at a time.
+         */
+        struct SharedSamplingProfiler
+        {
+            /** Claims the sampler for the calling engine, returning false if another
+             *  engine holds it.
+             */
+            static bool tryAcquire()
+            {
+                bool expected = false;
+                return getInUse().compare_exchange_strong(expected, true);
+            }
+
+            static void release()
+            {
+                jassert(getInUse());
+                getInUse() = false;
+            }
+
+        private:
+            static std::atomic<bool>& getInUse()
+            {
+                static std::atomic<bool> inUse { false };
+                return inUse;
+            }
+        };
+
+        //==============================================================================
+        /** Converts a trace dumped by the Hermes sampling profiler, in the Chrome trace
+         *  event format, into a profile.
+         *
+         *  The trace holds a tree of stack frames, each naming its parent, and samples
+         *  which each name the frame at the top of their stack.
+         */
+        EcmascriptEngine::Profile parseHermesSampledTrace(const std::string &trace)
+        {
+            const auto json = juce::JSON::parse(juce::String::fromUTF8(trace.data(), static_cast<int>(trace.size())));
+
+            const auto *stackFrames = json["stackFrames"].getDynamicObject();
+            const auto *samples     = json["samples"].getArray();
+
+            EcmascriptEngine::Profile profile;
+
+            if (stackFrames == nullptr || samples == nullptr)
+                return profile;
+
+            std::unordered_map<juce::String, int> frameIndices;
+
+            // Returns the stack ending at the given frame, outermost call first
+            const std::function<std::vector<int>(const juce::String&)> getStack = [&] (const juce::String &id)
+            {
+                const auto frame = stackFrames->getProperty(id);
+
+                if (!frame.isObject() || frame["category"].toString() == "root")
+                    return std::vector<int>();
+
+                auto stack = frame.hasProperty("parent") ? getStack(frame["parent"].toString())
+                                                         : std::vector<int>();
+
+                auto [it, isNew] = frameIndices.emplace(id, static_cast<int>(profile.frames.size()));
+
+                if (isNew)
+                    profile.frames.push_back({ frame["name"].toString(), frame["url"].toString(), static_cast<int>(frame["line"]) });
+
+                stack.push_back(it->second);
+                return stack;
+            };
+
+            for (const auto &sample : *samples)
+            {
+                // Timestamps are in microseconds, and may come as strings
+                const auto timeMs = sample["ts"].toString().getDoubleValue() / 1000.0;
+
+                if (profile.samples.empty())
+                    profile.startTimeMs = timeMs;
+
+                profile.samples.push_back({ timeMs, getStack(sample["sf"].toString()) });
+                profile.endTimeMs = timeMs;
+            }
+
+            return profile;
+        }
+
         //==============================================================================
     }
 
+    //==============================================================================
+    /** Prepared JavaScript holds the compiled bytecode and may be evaluated in any
+     *  Hermes runtime, so we keep that as the compiled form of a bundle.
+     */
+    struct EcmascriptEngine::CompiledBundle
+    {
+        juce::String name;
+        std::shared_ptr<const jsi::PreparedJavaScript> preparedJavaScript;
+    };
+
     //==============================================================================
     struct EcmascriptEngine::Pimpl
     {
         //==============================================================================
-        struct TimeoutFunctionManager : private juce::MultiTimer
+        /** Schedules the runtime's timeouts and intervals on a single native timer, set
+         *  for whichever of them is due next.
+         */
+        struct TimeoutFunctionManager : private juce::Timer
         {
-            explicit TimeoutFunctionManager(jsi::Runtime &rt)
-                : runtime(rt)
+            explicit TimeoutFunctionManager(std::function<void()> onTimersDue)
+                : dispatchTimers(std::move(onTimersDue))
             { }
 
             ~TimeoutFunctionManager() override
@@ -267,86 +560,152 @@ namespace reactjuce
 
             void clear()
             {
-                std::for_each(timeoutFunctions.cbegin(), timeoutFunctions.cend(), [this] (const auto &tf)
-                {
-                    stopTimer(tf.first);
-                });
+                stopTimer();
+                timers.clear();
+            }
 
-                timeoutFunctions.clear();
+            void clearTimeout(const int id)
+            {
+                timers.remove(id);
+                scheduleNextTimer();
             }
 
-            jsi::Value clearTimeout(const int id)
+            int newTimeout(const double timeoutMillis, const bool repeats)
             {
-                stopTimer(id);
+                const int id = timers.add(timeoutMillis, repeats, juce::Time::getMillisecondCounterHiRes());
+                scheduleNextTimer();
 
-                if (const auto f = timeoutFunctions.find(id); f != timeoutFunctions.cend())
-                    timeoutFunctions.erase(f);
+                return id;
+            }
 
-                return jsi::Value();
+            void timerCallback() override
+            {
+                // The due timers may run on another thread, which reschedules us
+                stopTimer();
+                dispatchTimers();
             }
 
-            jsi::Value newTimeout(jsi::Function f, const int timeoutMillis, std::vector<jsi::Value> args, const bool repeats=false)
+            /** Returns the ids of every timeout which is due, in the order they fell due. */
+            std::vector<int> takeDueTimeouts()
             {
-                static int nextId = 0;
-                timeoutFunctions.emplace(nextId, TimeoutFunction(std::move(f), std::move(args), repeats));
-                startTimer(nextId, timeoutMillis);
+                auto due = timers.takeExpired(juce::Time::getMillisecondCounterHiRes());
+                scheduleNextTimer();
 
-                return nextId++;
+                return due;
             }
 
-            void timerCallback(int id) override
+        private:
+            void scheduleNextTimer()
             {
-                if (const auto f = timeoutFunctions.find(id); f != timeoutFunctions.cend())
-                {
-                    TimeoutFunction &cb = f->second;
+                const auto dueTime = timers.getNextDueTime();
 
-                    const jsi::Value *argsPtr = cb.args.data();
-                    cb.f.call(runtime, argsPtr, cb.args.size());
+                if (dueTime < 0.0)
+                    return stopTimer();
 
-                    if (!cb.repeats)
-                    {
-                        stopTimer(id);
-                        timeoutFunctions.erase(f);
-                    }
-                }
+                const auto delayMs = dueTime - juce::Time::getMillisecondCounterHiRes();
+                startTimer(juce::jmax(1, static_cast<int>(std::ceil(delayMs))));
             }
 
-        private:
-            struct TimeoutFunction
+            detail::TimerQueue      timers;
+            std::function<void()>   dispatchTimers;
+        };
+
+        /** Called on the message thread when timeouts fall due. */
+        void dispatchTimeouts()
+        {
+            if (!callbackDispatcher)
+                return runDueTimeouts();
+
+            // Whichever manager is current once the callback runs works out for itself
+            // which of its timeouts are due, so a reset in between is harmless.
+            callbackDispatcher([this] {
+                if (timeoutsManager)
+                    runDueTimeouts();
+            });
+        }
+
+        /** Hands every timeout which is due to the timer trampoline in a single call. */
+        void runDueTimeouts()
+        {
+            const auto due = timeoutsManager->takeDueTimeouts();
+
+            if (due.empty())
+                return;
+
+            detail::ExecutionBudget::Scope budgetScope(executionBudget);
+
+            try
             {
-                TimeoutFunction(jsi::Function _f, std::vector<jsi::Value> _args, const bool _repeats=false)
-                    : f(std::move(_f))
-                    , args(std::move(_args))
-                    , repeats(_repeats)
-                { }
+                jsi::Array ids(*runtime, due.size());
 
-                jsi::Function           f;
-                std::vector<jsi::Value> args;
-                const bool              repeats;
-            };
+                for (size_t i = 0; i < due.size(); ++i)
+                    ids.setValueAtIndex(*runtime, i, due[i]);
 
-            jsi::Runtime                   &runtime;
-            std::map<int, TimeoutFunction>  timeoutFunctions;
-        };
+                runTimersFunction->call(*runtime, std::move(ids));
+            }
+            catch (const jsi::JSIException &e)
+            {
+                throw Error(e.what());
+            }
+        }
+
+        void setCallbackDispatcher(CallbackDispatcher dispatcher)
+        {
+            callbackDispatcher = std::move(dispatcher);
+        }
 
         //==============================================================================
-        Pimpl()
+        explicit Pimpl(AllocatorPolicy policy)
         {
+            // Hermes manages its own heap, so every policy behaves as System here.
+            juce::ignoreUnused(policy);
+
+            // Hermes times a call from when the runtime is put under watch, so we
+            // watch it for the length of each outermost call only
+            executionBudget.onCallStarted = [this](double limitMs)
+            {
+                if (limitMs > 0.0)
+                {
+                    runtime->watchTimeLimit(static_cast<uint32_t>(std::ceil(limitMs)));
+                    isWatchingTimeLimit = true;
+                }
+            };
+
+            executionBudget.onCallFinished = [this]
+            {
+                if (isWatchingTimeLimit)
+                {
+                    runtime->unwatchTimeLimit();
+                    isWatchingTimeLimit = false;
+                }
+            };
+
             reset();
         }
 
-        ~Pimpl() = default;
+        ~Pimpl()
+        {
+            // The sampler would otherwise go on sampling a runtime that no longer exists
+            if (profiling)
+            {
+                facebook::hermes::HermesRuntime::disableSamplingProfiler();
+                runtime->unregisterForProfiling();
+                SharedSamplingProfiler::release();
+            }
+        }
 
         //==============================================================================
         juce::var evaluateInline(const juce::String &code)
         {
+            detail::ExecutionBudget::Scope budgetScope(executionBudget);
+
             try
             {
                 auto jsiBuffer = std::make_shared<jsi::StringBuffer>(code.toStdString());
                 auto js        = runtime->prepareJavaScript(jsiBuffer, "");
                 auto result    = runtime->evaluatePreparedJavaScript(js);
 
-                return jsiValueToVar(result, *runtime);
+                return jsiValueToVar(result, *runtime, propertyKeys);
             }
             catch (const jsi::JSIException &e)
             {
@@ -354,15 +713,32 @@ namespace reactjuce
             }
         }
 
-        juce::var evaluate(const juce::File &code)
+        //==============================================================================
+        std::shared_ptr<const CompiledBundle> compile(const juce::File &code, const juce::MemoryBlock &data)
+        {
+            auto jsiBuffer = std::make_shared<jsi::StringBuffer>(std::string(static_cast<const char*>(data.getData()), data.getSize()));
+            return prepare(code.getFullPathName(), std::move(jsiBuffer));
+        }
+
+        std::shared_ptr<const CompiledBundle> compileBytecode(const juce::String &name, std::shared_ptr<const void> owner, const void *data, size_t size)
+        {
+            // Hermes reads bytecode in place, but only from suitably aligned memory,
+            // which mapped files always are and embedded binary data may not be
+            if (reinterpret_cast<uintptr_t>(data) % alignof(uint64_t) != 0)
+                return prepare(name, std::make_shared<JSIMemoryBuffer>(std::make_unique<juce::MemoryBlock>(data, size)));
+
+            return prepare(name, std::make_shared<JSIExternalBuffer>(std::move(owner), data, size));
+        }
+
+        std::shared_ptr<const CompiledBundle> prepare(const juce::String &name, std::shared_ptr<const jsi::Buffer> jsiBuffer)
         {
             try
             {
-                auto jsiBuffer = std::make_shared<jsi::StringBuffer>(code.loadFileAsString().toStdString());
-                auto js        = runtime->prepareJavaScript(jsiBuffer, code.getFullPathName().toStdString());
-                auto result    = runtime->evaluatePreparedJavaScript(js);
+                auto compiled  = std::make_shared<CompiledBundle>();
+                compiled->name = name;
+                compiled->preparedJavaScript = runtime->prepareJavaScript(std::move(jsiBuffer), name.toStdString());
 
-                return jsiValueToVar(result, *runtime);
+                return compiled;
             }
             catch (const jsi::JSIException &e)
             {
@@ -370,18 +746,14 @@ namespace reactjuce
             }
         }
 
-        juce::var evaluateBytecode(const juce::File &code)
+        juce::var evaluateCompiled(const CompiledBundle &compiled)
         {
+            detail::ExecutionBudget::Scope budgetScope(executionBudget);
+
             try
             {
-                auto memBlock = std::make_unique<juce::MemoryBlock>();
-                code.loadFileAsData(*memBlock);
-
-                auto jsiBuffer = std::make_shared<JSIMemoryBuffer>(std::move(memBlock));
-                auto js        = runtime->prepareJavaScript(jsiBuffer, code.getFullPathName().toStdString());
-                auto result    = runtime->evaluatePreparedJavaScript(js);
-
-                return jsiValueToVar(result, *runtime);
+                auto result = runtime->evaluatePreparedJavaScript(compiled.preparedJavaScript);
+                return jsiValueToVar(result, *runtime, propertyKeys);
             }
             catch (const jsi::JSIException &e)
             {
@@ -394,7 +766,7 @@ namespace reactjuce
         {
             try
             {
-                runtime->global().setProperty(*runtime, name.toRawUTF8(), varToJSIValue(value, *runtime));
+                runtime->global().setProperty(*runtime, name.toRawUTF8(), varToJSIValue(value, *runtime, propertyKeys));
             }
             catch (const jsi::JSIException &e)
             {
@@ -407,7 +779,22 @@ namespace reactjuce
             try
             {
                 auto obj = runtime->global().getPropertyAsObject(*runtime, target.toRawUTF8());
-                obj.setProperty(*runtime, name.toRawUTF8(), varToJSIValue(value, *runtime));
+                obj.setProperty(*runtime, name.toRawUTF8(), varToJSIValue(value, *runtime, propertyKeys));
+            }
+            catch (const jsi::JSIException &e)
+            {
+                throw Error(e.what());
+            }
+        }
+
+        void registerTypedNativeFunction(const juce::String &target, const juce::String &name, int numArgs, TypedNativeFunction fn)
+        {
+            try
+            {
+                auto obj = target.isEmpty() ? runtime->global()
+                                            : runtime->global().getPropertyAsObject(*runtime, target.toRawUTF8());
+
+                obj.setProperty(*runtime, name.toRawUTF8(), createTypedHostFunction(name, numArgs, std::move(fn)));
             }
             catch (const jsi::JSIException &e)
             {
@@ -416,89 +803,220 @@ namespace reactjuce
         }
 
         //==============================================================================
-        //TODO: We can probably improve on this by refining the invoke API
         juce::var invoke(const juce::String &name, const std::vector<juce::var> &vargs)
         {
             try
             {
-                juce::StringArray accessors;
-                accessors.addTokens(name.trim(), ".", "");
-                accessors.removeEmptyStrings();
+                return callFunction(resolveFunction(name), vargs);
+            }
+            catch(const jsi::JSIException &e)
+            {
+                throw Error(e.what());
+            }
+        }
 
-                jsi::Value prop = runtime->global();
+        //==============================================================================
+        FunctionHandle resolve(const juce::String &name)
+        {
+            try
+            {
+                resolvedFunctions.push_back(resolveFunction(name));
+                return { static_cast<int>(resolvedFunctions.size()) - 1, generation };
+            }
+            catch(const jsi::JSIException &e)
+            {
+                throw Error(e.what());
+            }
+        }
 
-                for (auto &p : accessors)
-                {
-                    if (prop.isObject())
-                    {
-                        jsi::Object obj = prop.getObject(*runtime);
-                        prop = obj.getProperty(*runtime, p.toRawUTF8());
-                    }
-                }
+        bool isValid(const FunctionHandle &handle) const
+        {
+            return handle.generation == generation
+                && juce::isPositiveAndBelow(handle.index, static_cast<int>(resolvedFunctions.size()));
+        }
 
-                auto func = prop.getObject(*runtime).asFunction(*runtime);
+        juce::var invoke(const FunctionHandle &handle, const std::vector<juce::var> &vargs)
+        {
+            if (!isValid(handle))
+                throw Error("Invocation failed, the function handle is no longer valid.");
 
-                std::vector<jsi::Value> jsiArgs;
-                for (auto &v : vargs)
+            try
+            {
+                return callFunction(resolvedFunctions[static_cast<size_t>(handle.index)], vargs);
+            }
+            catch(const jsi::JSIException &e)
+            {
+                throw Error(e.what());
+            }
+        }
+
+        //==============================================================================
+        /** Walks the dotted accessor path from the global object to the named function. */
+        jsi::Function resolveFunction(const juce::String &name)
+        {
+            juce::StringArray accessors;
+            accessors.addTokens(name.trim(), ".", "");
+            accessors.removeEmptyStrings();
+
+            jsi::Value prop = runtime->global();
+
+            for (auto &p : accessors)
+            {
+                if (prop.isObject())
                 {
-                    jsiArgs.push_back(varToJSIValue(v, *runtime));
+                    jsi::Object obj = prop.getObject(*runtime);
+                    prop = obj.getProperty(*runtime, p.toRawUTF8());
                 }
+            }
 
-                const jsi::Value *argsPtr = jsiArgs.data();
-                jsi::Value result = func.call(*runtime, argsPtr, jsiArgs.size());
+            return prop.getObject(*runtime).asFunction(*runtime);
+        }
 
-                return jsiValueToVar(result, *runtime);
-            }
-            catch(const jsi::JSIException &e)
+        juce::var callFunction(const jsi::Function &func, const std::vector<juce::var> &vargs)
+        {
+            detail::ExecutionBudget::Scope budgetScope(executionBudget);
+
+            std::vector<jsi::Value> jsiArgs;
+            jsiArgs.reserve(vargs.size());
+
+            for (auto &v : vargs)
             {
-                throw Error(e.what());
+                jsiArgs.push_back(varToJSIValue(v, *runtime, propertyKeys));
             }
+
+            const jsi::Value *argsPtr = jsiArgs.data();
+            jsi::Value result = func.call(*runtime, argsPtr, jsiArgs.size());
+
+            return jsiValueToVar(result, *runtime, propertyKeys);
         }
 
         //==============================================================================
-        jsi::Function createSetTimerFunction(bool isInterval)
+        /** Gives a typed native function direct access to the host function arguments. */
+        struct JSICallFrame : public NativeCallFrame
+        {
+            JSICallFrame(jsi::Runtime &r, PropertyKeyTable &k, const jsi::Value *a)
+                : rt(r), keys(k), args(a) {}
+
+            // Arguments of another type are coerced as JavaScript's Number(), Boolean()
+            // and String() would, matching the conversions of the other backends.
+            double getNumber(int index) override
+            {
+                const auto &arg = args[index];
+                return arg.isNumber() ? arg.getNumber() : coerce("Number", arg).getNumber();
+            }
+
+            bool getBool(int index) override
+            {
+                const auto &arg = args[index];
+                return arg.isBool() ? arg.getBool() : coerce("Boolean", arg).getBool();
+            }
+
+            juce::var getVar(int index) override            { return jsiValueToVar(args[index], rt, keys); }
+
+            std::string_view getString(int index) override
+            {
+                const auto &arg = args[index];
+
+                // Hold on to the converted strings so that the returned views stay
+                // valid for the duration of the call. A forward_list allocates nothing
+                // until the first string, and never moves the strings it holds.
+                strings.push_front(arg.isString() ? arg.getString(rt).utf8(rt) : arg.toString(rt).utf8(rt));
+                return strings.front();
+            }
+
+            void returnNumber(double value) override        { result = jsi::Value(value); }
+            void returnBool(bool value) override            { result = jsi::Value(value); }
+            void returnVar(const juce::var &value) override { result = varToJSIValue(value, rt, keys); }
+
+            void returnString(std::string_view value) override
+            {
+                result = jsi::String::createFromUtf8(rt, reinterpret_cast<const uint8_t*>(value.data()), value.size());
+            }
+
+            jsi::Value coerce(const char *constructorName, const jsi::Value &arg)
+            {
+                return rt.global().getPropertyAsFunction(rt, constructorName).call(rt, arg);
+            }
+
+            jsi::Runtime                  &rt;
+            PropertyKeyTable              &keys;
+            const jsi::Value              *args;
+            std::forward_list<std::string> strings;
+            jsi::Value                     result;
+        };
+
+        jsi::Function createTypedHostFunction(const juce::String &name, int numArgs, TypedNativeFunction fn)
         {
             return jsi::Function::createFromHostFunction(
                 *runtime,
-                jsi::PropNameID::forAscii(*runtime, ""),
-                0,
-                [=] (jsi::Runtime& rt, const jsi::Value& thisVal, const jsi::Value* args, size_t count)
+                jsi::PropNameID::forUtf8(*runtime, name.toStdString()),
+                static_cast<unsigned int>(numArgs),
+                [numArgs, f = std::move(fn), &keys = propertyKeys] (jsi::Runtime& rt, const jsi::Value& thisVal, const jsi::Value* args, size_t count)
                 {
                     juce::ignoreUnused(thisVal);
 
-                    jsi::Function fn      = args[0].asObject(rt).asFunction(rt);
-                    const auto    timeout = static_cast<int>(args[1].asNumber());
+                    if (count != static_cast<size_t>(numArgs))
+                    {
+                        throw jsi::JSError(rt, "Native function expected " + std::to_string(numArgs)
+                                               + " arguments but received " + std::to_string(count));
+                    }
+
+                    JSICallFrame frame(rt, keys, args);
 
-                    std::vector<jsi::Value> timeoutArgs;
-                    if (count > 2)
+                    try
                     {
-                        for (size_t i = 2; i < count; ++i)
-                        {
-                            timeoutArgs.emplace_back(jsi::Value(rt, args[i]));
-                        }
+                        f(frame);
+                    }
+                    catch (const Error &err)
+                    {
+                        throw jsi::JSError(rt, err.what());
                     }
 
-                    return timeoutsManager->newTimeout(std::move(fn), timeout, std::move(timeoutArgs), isInterval);
+                    return std::move(frame.result);
                 }
             );
         }
 
-        jsi::Function createClearTimerFunction()
+        //==============================================================================
+        /** Installs the timer globals, whose callbacks live in a table on the JavaScript
+         *  side, and keeps the trampoline that runs them.
+         */
+        void installTimerGlobals()
         {
-            return jsi::Function::createFromHostFunction(
+            auto jsiBuffer = std::make_shared<jsi::StringBuffer>(detail::timerGlobalsScript);
+            auto install   = runtime->evaluateJavaScript(jsiBuffer, "<timers>").asObject(*runtime).asFunction(*runtime);
+
+            auto scheduleTimer = jsi::Function::createFromHostFunction(
                 *runtime,
                 jsi::PropNameID::forAscii(*runtime, ""),
-                0,
+                2,
                 [this] (jsi::Runtime& rt, const jsi::Value& thisVal, const jsi::Value* args, size_t count)
                 {
                     juce::ignoreUnused(rt);
                     juce::ignoreUnused(thisVal);
                     juce::ignoreUnused(count);
 
-                    const auto timerId = static_cast<int>(args[0].asNumber());
-                    return timeoutsManager->clearTimeout(timerId);
+                    return jsi::Value(timeoutsManager->newTimeout(args[0].asNumber(), args[1].getBool()));
                 }
             );
+
+            auto cancelTimer = jsi::Function::createFromHostFunction(
+                *runtime,
+                jsi::PropNameID::forAscii(*runtime, ""),
+                1,
+                [this] (jsi::Runtime& rt, const jsi::Value& thisVal, const jsi::Value* args, size_t count)
+                {
+                    juce::ignoreUnused(rt);
+                    juce::ignoreUnused(thisVal);
+                    juce::ignoreUnused(count);
+
+                    timeoutsManager->clearTimeout(static_cast<int>(args[0].asNumber()));
+                    return jsi::Value();
+                }
+            );
+
+            auto runTimers = install.call(*runtime, runtime->global(), scheduleTimer, cancelTimer);
+            runTimersFunction = std::make_unique<jsi::Function>(runTimers.asObject(*runtime).asFunction(*runtime));
         }
 
         //==============================================================================
@@ -507,8 +1025,29 @@ namespace reactjuce
             if (timeoutsManager)
                 timeoutsManager->clear();
 
+            // Resolved functions and cached property keys must be released before
+            // the runtime that owns them
+            resolvedFunctions.clear();
+            ++generation;
+
+            runTimersFunction.reset();
+            propertyKeys.clear();
+
+            // The sampler keeps a list of the runtimes it samples
+            if (profiling)
+                runtime->unregisterForProfiling();
+
             runtime         = facebook::hermes::makeHermesRuntime();
-            timeoutsManager = std::make_unique<TimeoutFunctionManager>(*runtime);
+
+            if (profiling)
+                runtime->registerForProfiling();
+
+            isWatchingTimeLimit = false;
+
+            if (executionBudget.getLimit() > 0.0)
+                enableTimeLimitChecks();
+
+            timeoutsManager = std::make_unique<TimeoutFunctionManager>([this]() { dispatchTimeouts(); });
 
             // Quick and dirty console object provide. Could be improved upon.
             jsi::Function logFunction =
@@ -523,9 +1062,8 @@ namespace reactjuce
 
                         for (size_t i = 0; i < count; ++i)
                         {
-                            auto s = args[i].toString(rt).utf8(rt);
-                            logString.append(s, s.size());
-                            logString.append(" ", 1u);
+                            logString << jsiStringToString(args[i].toString(rt), rt);
+                            logString << " ";
                         }
 
                         juce::Logger::writeToLog(logString);
@@ -536,13 +1074,105 @@ namespace reactjuce
             auto console = jsi::Object(*runtime);
             console.setProperty(*runtime, "log", logFunction);
 
-            runtime->global().setProperty(*runtime, "console"      , console);
-            runtime->global().setProperty(*runtime, "setTimeout"   , createSetTimerFunction(false));
-            runtime->global().setProperty(*runtime, "setInterval"  , createSetTimerFunction(true));
-            runtime->global().setProperty(*runtime, "clearTimeout" , createClearTimerFunction());
-            runtime->global().setProperty(*runtime, "clearInterval", createClearTimerFunction());
+            runtime->global().setProperty(*runtime, "console", console);
+
+            installTimerGlobals();
+        }
+
+        //==============================================================================
+        MemoryStats getMemoryStats() const
+        {
+            // Hermes reports the size of its heap but not how many allocations it holds,
+            // so we leave the allocation counts empty and track the peak on each query.
+            const auto heapInfo = runtime->instrumentation().getHeapInfo(false);
+
+            MemoryStats stats;
+
+            if (auto it = heapInfo.find("hermes_allocatedBytes"); it != heapInfo.end())
+                stats.liveBytes = static_cast<size_t>(it->second);
+
+            peakBytes = std::max(peakBytes, stats.liveBytes);
+            stats.peakBytes = peakBytes;
+
+            return stats;
+        }
+
+        void collectGarbage()
+        {
+            runtime->instrumentation().collectGarbage("idle");
+        }
+
+        //==============================================================================
+        void startProfiling(double sampleIntervalMs)
+        {
+            // The Hermes sampler runs at a fixed rate of its own choosing
+            juce::ignoreUnused(sampleIntervalMs);
+
+            if (profiling)
+                return;
+
+            if (!SharedSamplingProfiler::tryAcquire())
+                throw Error("Another engine is already profiling, and the Hermes sampler can't keep their samples apart.");
+
+            runtime->registerForProfiling();
+            facebook::hermes::HermesRuntime::enableSamplingProfiler();
+            profiling = true;
+        }
+
+        Profile stopProfiling()
+        {
+            if (!profiling)
+                return {};
+
+            facebook::hermes::HermesRuntime::disableSamplingProfiler();
+
+            std::ostringstream trace;
+            facebook::hermes::HermesRuntime::dumpSampledTraceToStream(trace);
+
+            runtime->unregisterForProfiling();
+            SharedSamplingProfiler::release();
+            profiling = false;
+
+            return parseHermesSampledTrace(trace.str());
+        }
+
+        bool isProfiling() const
+        {
+            return profiling;
+        }
+
+        //==============================================================================
+        void setExecutionBudget(double budgetMs)
+        {
+            if (budgetMs > 0.0 && executionBudget.getLimit() <= 0.0)
+                enableTimeLimitChecks();
+
+            executionBudget.setLimit(budgetMs);
+        }
+
+        double getExecutionBudget() const
+        {
+            return executionBudget.getLimit();
+        }
+
+        ExecutionStats getExecutionStats() const
+        {
+            return executionBudget.getStats();
         }
 
+        /** Hermes only compiles the checks which let it interrupt a call once a
+         *  runtime has first been put under watch, so we do that up front.
+         */
+        void enableTimeLimitChecks()
+        {
+            if (isWatchingTimeLimit)
+                return;
+
+            runtime->watchTimeLimit(std::numeric_limits<uint32_t>::max());
+            runtime->unwatchTimeLimit();
+        }
+
+        //==============================================================================
         void debuggerAttach()
         {
             //TODO: Implement Hermed debug support
@@ -556,7 +1186,18 @@ namespace reactjuce
         }
 
         std::unique_ptr<TimeoutFunctionManager>          timeoutsManager;
+        CallbackDispatcher                               callbackDispatcher;
         std::unique_ptr<facebook::hermes::HermesRuntime> runtime;
+
+        // Declared after the runtime so that these are destroyed before it.
+        std::vector<jsi::Function>                       resolvedFunctions;
+        std::unique_ptr<jsi::Function>                   runTimersFunction;
+        PropertyKeyTable                                 propertyKeys;
+        juce::uint32                                     generation = 0;
+        mutable size_t                                   peakBytes = 0;
+        bool                                             profiling = false;
+        bool                                             isWatchingTimeLimit = false;
+        detail::ExecutionBudget                          executionBudget;
     };
 
     //==============================================================================
@@ -0,0 +1,1172 @@
+#include "EcmascriptEngine.h"
+
+#if _MSC_VER
+#pragma warning(push)
+#elif __clang__
+#pragma clang diagnostic push
+ #pragma clang diagnostic ignored "-Wextra-semi"
+ #pragma clang diagnostic ignored "-Wc99-extensions"
+ #pragma clang diagnostic ignored "-Wgnu-anonymous-struct"
+ #pragma clang diagnostic ignored "-Wzero-as-null-pointer-constant"
+#elif __GNUC__
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpedantic"
+#pragma GCC diagnostic ignored "-Wzero-as-null-pointer-constant"
+#endif
+
+#include <quickjs.h>
+
+#if _MSC_VER
+#elif __clang__
+#pragma clang diagnostic pop
+#elif __GNUC__
+#pragma GCC diagnostic pop
+#endif
+
+namespace reactjuce
+{
+    namespace
+    {
+        //==============================================================================
+        /** Owns one reference to a JSValue, releasing it when destroyed. */
+        class ScopedValue
+        {
+        public:
+            ScopedValue() = default;
+
+            /** Takes over the reference held by the given value. */
+            ScopedValue(JSContext *c, JSValue v)
+                : ctx(c), value(v)
+            { }
+
+            ScopedValue(const ScopedValue &other)
+                : ctx(other.ctx), value(other.ctx ? JS_DupValue(other.ctx, other.value) : other.value)
+            { }
+
+            ScopedValue(ScopedValue &&other) noexcept
+                : ctx(std::exchange(other.ctx, nullptr)), value(other.value)
+            { }
+
+            ScopedValue& operator=(ScopedValue other) noexcept
+            {
+                std::swap(ctx, other.ctx);
+                std::swap(value, other.value);
+                return *this;
+            }
+
+            ~ScopedValue()
+            {
+                if (ctx)
+                    JS_FreeValue(ctx, value);
+            }
+
+            JSValueConst get() const   { return value; }
+
+            /** Hands the reference back to the caller. */
+            JSValue release()
+            {
+                ctx = nullptr;
+                return value;
+            }
+
+        private:
+            JSContext *ctx = nullptr;
+            JSValue    value = JS_UNDEFINED;
+        };
+
+        //==============================================================================
+        /** A native function callable from JavaScript, in the shape of a JSI host function. */
+        using HostFunction = std::function<JSValue(JSContext*, JSValueConst, int, JSValueConst*)>;
+
+        /** The class of the objects that carry a HostFunction as the data of the
+         *  QuickJS function wrapping it, and delete it once that function is collected.
+         */
+        JSClassID getHostFunctionClassId()
+        {
+            static const JSClassID classId = []
+            {
+                JSClassID id = 0;
+                JS_NewClassID(&id);
+                return id;
+            }();
+
+            return classId;
+        }
+
+        void finalizeHostFunction(JSRuntime *rt, JSValue val)
+        {
+            juce::ignoreUnused(rt);
+            delete static_cast<HostFunction*>(JS_GetOpaque(val, getHostFunctionClassId()));
+        }
+
+        JSValue callHostFunction(JSContext *ctx, JSValueConst thisVal, int argc, JSValueConst *argv, int magic, JSValue *data)
+        {
+            juce::ignoreUnused(magic);
+
+            auto *fn = static_cast<HostFunction*>(JS_GetOpaque(data[0], getHostFunctionClassId()));
+            jassert(fn != nullptr);
+
+            // C++ exceptions mustn't unwind through the interpreter, so we hand them
+            // back to the calling script as a TypeError, as the other backends do.
+            try
+            {
+                return (*fn)(ctx, thisVal, argc, argv);
+            }
+            catch (const std::exception &e)
+            {
+                return JS_ThrowTypeError(ctx, "%s", e.what());
+            }
+        }
+
+        JSValue createHostFunction(JSContext *ctx, int length, HostFunction fn)
+        {
+            JSValue holder = JS_NewObjectClass(ctx, static_cast<int>(getHostFunctionClassId()));
+            JS_SetOpaque(holder, new HostFunction(std::move(fn)));
+
+            JSValue function = JS_NewCFunctionData(ctx, &callHostFunction, length, 0, 1, &holder);
+            JS_FreeValue(ctx, holder);
+
+            return function;
+        }
+
+        //==============================================================================
+        /** Returns the string value of the given value, or an empty string should the
+         *  conversion itself throw.
+         */
+        juce::String toJuceString(JSContext *ctx, JSValueConst v)
+        {
+            size_t length = 0;
+
+            if (const char *str = JS_ToCStringLen(ctx, &length, v))
+            {
+                auto result = juce::String::fromUTF8(str, static_cast<int>(length));
+                JS_FreeCString(ctx, str);
+                return result;
+            }
+
+            JS_FreeValue(ctx, JS_GetException(ctx));
+            return {};
+        }
+
+        //==============================================================================
+        /** Caches the property keys seen while marshalling objects, so that objects
+         *  with the same shape crossing the bridge repeatedly reuse one atom and one
+         *  juce::Identifier per key instead of recreating both for every object.
+         *
+         *  The table is bounded, after which unseen keys take the uncached path, so that
+         *  objects used as maps with arbitrary keys can't grow it without limit.
+         */
+        class PropertyKeyTable
+        {
+        public:
+            /** Returns the cached atom for the given identifier, or JS_ATOM_NULL if the table is full. */
+            JSAtom lookup(JSContext *ctx, const juce::Identifier &identifier)
+            {
+                if (auto it = atomsByIdentifier.find(identifier.getCharPointer().getAddress()); it != atomsByIdentifier.end())
+                    return it->second;
+
+                if (identifiersByAtom.size() >= maxNumKeys)
+                    return JS_ATOM_NULL;
+
+                const auto name = identifier.toString();
+                const auto atom = JS_NewAtomLen(ctx, name.toRawUTF8(), name.getNumBytesAsUTF8());
+
+                add(atom, identifier);
+                return atom;
+            }
+
+            /** Returns the identifier for the given atom, caching it if there's room. */
+            juce::Identifier lookup(JSContext *ctx, JSAtom atom)
+            {
+                if (auto it = identifiersByAtom.find(atom); it != identifiersByAtom.end())
+                    return it->second;
+
+                const char *str = JS_AtomToCString(ctx, atom);
+                const juce::Identifier identifier(juce::String::fromUTF8(str));
+                JS_FreeCString(ctx, str);
+
+                if (identifiersByAtom.size() < maxNumKeys)
+                    add(JS_DupAtom(ctx, atom), identifier);
+
+                return identifier;
+            }
+
+            /** Releases every cached atom. Must be called before the owning context is freed. */
+            void clear(JSContext *ctx)
+            {
+                for (auto &entry : identifiersByAtom)
+                    JS_FreeAtom(ctx, entry.first);
+
+                identifiersByAtom.clear();
+                atomsByIdentifier.clear();
+            }
+
+        private:
+            void add(JSAtom atom, const juce::Identifier &identifier)
+            {
+                auto it = identifiersByAtom.emplace(atom, identifier).first;
+                atomsByIdentifier.emplace(it->second.getCharPointer().getAddress(), atom);
+            }
+
+            static constexpr size_t maxNumKeys = 1024;
+
+            // Identifiers are pooled, so the address of an identifier's characters
+            // identifies it for as long as our copy in the table keeps it alive.
+            std::unordered_map<JSAtom, juce::Identifier>  identifiersByAtom;
+            std::unordered_map<const char*, JSAtom>       atomsByIdentifier;
+        };
+
+        //==============================================================================
+    }
+
+    //==============================================================================
+    /** QuickJS serialises compiled functions to a bytecode buffer which loads into
+     *  any runtime of the same build, so we keep that as the compiled form of a bundle.
+     */
+    struct EcmascriptEngine::CompiledBundle
+    {
+        juce::String      name;
+        juce::MemoryBlock bytecode;
+    };
+
+    //==============================================================================
+    struct EcmascriptEngine::Pimpl
+    {
+        //==============================================================================
+        /** Schedules the context's timeouts and intervals on a single native timer, set
+         *  for whichever of them is due next.
+         */
+        struct TimeoutFunctionManager : private juce::Timer
+        {
+            explicit TimeoutFunctionManager(std::function<void()> onTimersDue)
+                : dispatchTimers(std::move(onTimersDue))
+            { }
+
+            ~TimeoutFunctionManager() override
+            {
+                clear();
+            }
+
+            void clear()
+            {
+                stopTimer();
+                timers.clear();
+            }
+
+            void clearTimeout(const int id)
+            {
+                timers.remove(id);
+                scheduleNextTimer();
+            }
+
+            int newTimeout(const double timeoutMillis, const bool repeats)
+            {
+                const int id = timers.add(timeoutMillis, repeats, juce::Time::getMillisecondCounterHiRes());
+                scheduleNextTimer();
+
+                return id;
+            }
+
+            void timerCallback() override
+            {
+                // The due timers may run on another thread, which reschedules us
+                stopTimer();
+                dispatchTimers();
+            }
+
+            /** Returns the ids of every timeout which is due, in the order they fell due. */
+            std::vector<int> takeDueTimeouts()
+            {
+                auto due = timers.takeExpired(juce::Time::getMillisecondCounterHiRes());
+                scheduleNextTimer();
+
+                return due;
+            }
+
+        private:
+            void scheduleNextTimer()
+            {
+                const auto dueTime = timers.getNextDueTime();
+
+                if (dueTime < 0.0)
+                    return stopTimer();
+
+                const auto delayMs = dueTime - juce::Time::getMillisecondCounterHiRes();
+                startTimer(juce::jmax(1, static_cast<int>(std::ceil(delayMs))));
+            }
+
+            detail::TimerQueue      timers;
+            std::function<void()>   dispatchTimers;
+        };
+
+        /** Called on the message thread when timeouts fall due. */
+        void dispatchTimeouts()
+        {
+            if (!callbackDispatcher)
+                return runDueTimeouts();
+
+            // Whichever manager is current once the callback runs works out for itself
+            // which of its timeouts are due, so a reset in between is harmless.
+            callbackDispatcher([this] {
+                if (timeoutsManager)
+                    runDueTimeouts();
+            });
+        }
+
+        /** Hands every timeout which is due to the timer trampoline in a single call. */
+        void runDueTimeouts()
+        {
+            const auto due = timeoutsManager->takeDueTimeouts();
+
+            if (due.empty())
+                return;
+
+            ScopedValue ids(context, JS_NewArray(context));
+
+            for (size_t i = 0; i < due.size(); ++i)
+                JS_SetPropertyUint32(context, ids.get(), static_cast<uint32_t>(i), JS_NewInt32(context, due[i]));
+
+            std::vector<JSValueConst> argv { ids.get() };
+            call(runTimersFunction.get(), argv);
+        }
+
+        void setCallbackDispatcher(CallbackDispatcher dispatcher)
+        {
+            callbackDispatcher = std::move(dispatcher);
+        }
+
+        //==============================================================================
+        /** A JavaScript function held on to by a juce::var::NativeFunction.
+         *
+         *  The engine keeps track of every one of these so that it can release them
+         *  before freeing the context they belong to, since the vars holding them may
+         *  well outlive it. Calling a released function does nothing.
+         */
+        struct PersistentFunction
+        {
+            PersistentFunction(Pimpl &e, JSValueConst f)
+                : engine(&e)
+                , fn(JS_DupValue(e.context, f))
+            {
+                engine->persistentFunctions.insert(this);
+            }
+
+            ~PersistentFunction()
+            {
+                if (engine)
+                {
+                    engine->persistentFunctions.erase(this);
+                    JS_FreeValue(engine->context, fn);
+                }
+            }
+
+            void release()
+            {
+                JS_FreeValue(engine->context, fn);
+                engine = nullptr;
+            }
+
+            Pimpl   *engine;
+            JSValue  fn;
+        };
+
+        //==============================================================================
+        /** The most stack a runtime may use, which has to fit within the smallest
+         *  default stack of the threads an engine might run on.
+         */
+        static constexpr size_t maxStackBytes = 256 * 1024;
+
+        //==============================================================================
+        explicit Pimpl(AllocatorPolicy policy)
+        {
+            // QuickJS sizes its allocations by asking the allocator for their usable
+            // size, which our allocators don't track, so every policy behaves as System.
+            juce::ignoreUnused(policy);
+
+            executionBudget.onCallStarted = [this](double)
+            {
+                JS_UpdateStackTop(runtime);
+            };
+
+            reset();
+        }
+
+        ~Pimpl()
+        {
+            destroyContext();
+        }
+
+        //==============================================================================
+        juce::var evaluateInline(const juce::String &code)
+        {
+            detail::ExecutionBudget::Scope budgetScope(executionBudget);
+
+            // QuickJS expects the source to be null terminated, which the raw UTF-8 is
+            auto result = checked(JS_Eval(context, code.toRawUTF8(), code.getNumBytesAsUTF8(), "<inline>", JS_EVAL_TYPE_GLOBAL));
+            runPendingJobs();
+
+            return valueToVar(result.get());
+        }
+
+        //==============================================================================
+        std::shared_ptr<const CompiledBundle> compile(const juce::File &code, const juce::MemoryBlock &data)
+        {
+            auto compiled  = std::make_shared<CompiledBundle>();
+            compiled->name = code.getFullPathName();
+
+            // The parser checks the stack too, but compiling isn't a call
+            JS_UpdateStackTop(runtime);
+
+            // The source has to be null terminated for the parser
+            const std::string source(static_cast<const char*>(data.getData()), data.getSize());
+
+            auto function = checked(JS_Eval(context,
+                                            source.c_str(),
+                                            source.size(),
+                                            compiled->name.toRawUTF8(),
+                                            JS_EVAL_TYPE_GLOBAL | JS_EVAL_FLAG_COMPILE_ONLY));
+
+            size_t size = 0;
+            uint8_t *buffer = JS_WriteObject(context, &size, function.get(), JS_WRITE_OBJ_BYTECODE);
+
+            if (buffer == nullptr)
+                throwPendingException();
+
+            compiled->bytecode = juce::MemoryBlock(buffer, size);
+            js_free(context, buffer);
+
+            return compiled;
+        }
+
+        std::shared_ptr<const CompiledBundle> compileBytecode(const juce::String &name, std::shared_ptr<const void> owner, const void *data, size_t size)
+        {
+            // JS_ReadObject copies everything it reads into the heap, so we keep a
+            // copy of the bytecode rather than the caller's buffer
+            juce::ignoreUnused(owner);
+
+            auto compiled      = std::make_shared<CompiledBundle>();
+            compiled->name     = name;
+            compiled->bytecode = juce::MemoryBlock(data, size);
+
+            return compiled;
+        }
+
+        juce::var evaluateCompiled(const CompiledBundle &compiled)
+        {
+            detail::ExecutionBudget::Scope budgetScope(executionBudget);
+
+            auto function = checked(JS_ReadObject(context,
+                                                  static_cast<const uint8_t*>(compiled.bytecode.getData()),
+                                                  compiled.bytecode.getSize(),
+                                                  JS_READ_OBJ_BYTECODE));
+
+            // JS_EvalFunction takes over our reference to the function
+            ++callDepth;
+            JSValue result = JS_EvalFunction(context, function.release());
+            --callDepth;
+
+            auto scopedResult = checked(result);
+            runPendingJobs();
+
+            return valueToVar(scopedResult.get());
+        }
+
+        //==============================================================================
+        void registerNativeProperty(const juce::String &name, const juce::var &value)
+        {
+            ScopedValue global(context, JS_GetGlobalObject(context));
+            setProperty(global.get(), name, varToValue(value));
+        }
+
+        void registerNativeProperty(const juce::String &target, const juce::String &name, const juce::var &value)
+        {
+            auto obj = resolveObject(target);
+            setProperty(obj.get(), name, varToValue(value));
+        }
+
+        void registerTypedNativeFunction(const juce::String &target, const juce::String &name, int numArgs, TypedNativeFunction fn)
+        {
+            auto obj = target.isEmpty() ? ScopedValue(context, JS_GetGlobalObject(context))
+                                        : resolveObject(target);
+
+            setProperty(obj.get(), name, createTypedHostFunction(numArgs, std::move(fn)));
+        }
+
+        //==============================================================================
+        juce::var invoke(const juce::String &name, const std::vector<juce::var> &vargs)
+        {
+            auto fn = resolveObject(name);
+
+            if (!JS_IsFunction(context, fn.get()))
+                throw Error("Invocation failed, target is not a function.");
+
+            return callFunction(fn.get(), vargs);
+        }
+
+        //==============================================================================
+        FunctionHandle resolve(const juce::String &name)
+        {
+            auto fn = resolveObject(name);
+
+            if (!JS_IsFunction(context, fn.get()))
+                throw Error("Resolve failed, target is not a function.");
+
+            resolvedFunctions.push_back(std::move(fn));
+            return { static_cast<int>(resolvedFunctions.size()) - 1, generation };
+        }
+
+        bool isValid(const FunctionHandle &handle) const
+        {
+            return handle.generation == generation
+                && juce::isPositiveAndBelow(handle.index, static_cast<int>(resolvedFunctions.size()));
+        }
+
+        juce::var invoke(const FunctionHandle &handle, const std::vector<juce::var> &vargs)
+        {
+            if (!isValid(handle))
+                throw Error("Invocation failed, the function handle is no longer valid.");
+
+            // Copied, since the call may resolve more functions and move the vector
+            const auto fn = resolvedFunctions[static_cast<size_t>(handle.index)];
+            return callFunction(fn.get(), vargs);
+        }
+
+        //==============================================================================
+        /** Walks the dotted accessor path from the global object to the named value. */
+        ScopedValue resolveObject(const juce::String &name)
+        {
+            juce::StringArray accessors;
+            accessors.addTokens(name.trim(), ".", "");
+            accessors.removeEmptyStrings();
+
+            ScopedValue prop(context, JS_GetGlobalObject(context));
+
+            for (auto &p : accessors)
+                if (JS_IsObject(prop.get()))
+                    prop = checked(JS_GetPropertyStr(context, prop.get(), p.toRawUTF8()));
+
+            return prop;
+        }
+
+        void setProperty(JSValueConst obj, const juce::String &name, JSValue value)
+        {
+            // JS_SetPropertyStr takes over the value even when it fails
+            if (JS_SetPropertyStr(context, obj, name.toRawUTF8(), value) < 0)
+                throwPendingException();
+        }
+
+        juce::var callFunction(JSValueConst fn, const std::vector<juce::var> &vargs)
+        {
+            std::vector<ScopedValue> args;
+            std::vector<JSValueConst> argv;
+
+            args.reserve(vargs.size());
+            argv.reserve(vargs.size());
+
+            for (auto &v : vargs)
+            {
+                args.emplace_back(context, varToValue(v));
+                argv.push_back(args.back().get());
+            }
+
+            return valueToVar(call(fn, argv).get());
+        }
+
+        /** Calls the function, running any promise jobs it queued once we're back
+         *  out of the outermost call into the context.
+         */
+        ScopedValue call(JSValueConst fn, std::vector<JSValueConst> &argv)
+        {
+            detail::ExecutionBudget::Scope budgetScope(executionBudget);
+
+            ++callDepth;
+            JSValue result = JS_Call(context, fn, JS_UNDEFINED, static_cast<int>(argv.size()), argv.data());
+            --callDepth;
+
+            auto scopedResult = checked(result);
+            runPendingJobs();
+
+            return scopedResult;
+        }
+
+        void runPendingJobs()
+        {
+            if (callDepth > 0)
+                return;
+
+            for (;;)
+            {
+                JSContext *jobContext = nullptr;
+                const int status = JS_ExecutePendingJob(runtime, &jobContext);
+
+                if (status == 0)
+                    break;
+
+                if (status < 0)
+                    throwPendingException();
+            }
+        }
+
+        //==============================================================================
+        /** Wraps the given value, throwing the context's pending exception instead
+         *  if it's the exception marker.
+         */
+        ScopedValue checked(JSValue v)
+        {
+            if (JS_IsException(v))
+                throwPendingException();
+
+            return { context, v };
+        }
+
+        [[noreturn]] void throwPendingException()
+        {
+            ScopedValue exception(context, JS_GetException(context));
+
+            const auto message = toJuceString(context, exception.get());
+            juce::String stack;
+
+            if (JS_IsError(context, exception.get()))
+            {
+                ScopedValue stackValue(context, JS_GetPropertyStr(context, exception.get(), "stack"));
+
+                if (!JS_IsUndefined(stackValue.get()) && !JS_IsException(stackValue.get()))
+                    stack = toJuceString(context, stackValue.get());
+            }
+
+            throw Error(message, stack);
+        }
+
+        //==============================================================================
+        juce::var valueToVar(JSValueConst v)
+        {
+            const auto tag = JS_VALUE_GET_TAG(v);
+
+            // Numbers always come across as doubles, as they do from the other
+            // backends, even when QuickJS happens to store them as integers.
+            if (JS_TAG_IS_FLOAT64(tag))
+                return JS_VALUE_GET_FLOAT64(v);
+
+            switch (tag)
+            {
+                case JS_TAG_INT:        return static_cast<double>(JS_VALUE_GET_INT(v));
+                case JS_TAG_BOOL:       return JS_VALUE_GET_BOOL(v) != 0;
+                case JS_TAG_STRING:     return toJuceString(context, v);
+                case JS_TAG_UNDEFINED:  return juce::var::undefined();
+                case JS_TAG_NULL:       return juce::var();
+                case JS_TAG_OBJECT:     return objectToVar(v);
+                default:                break;
+            }
+
+            jassertfalse;
+            return {};
+        }
+
+        juce::var objectToVar(JSValueConst v)
+        {
+            if (JS_IsArray(context, v) > 0)
+                return arrayToVar(v);
+
+            if (JS_IsFunction(context, v))
+                return functionToVar(v);
+
+            if (isInstanceOf(v, arrayBufferConstructor))
+            {
+                size_t size = 0;
+                const uint8_t *data = JS_GetArrayBuffer(context, &size, v);
+
+                if (data == nullptr)
+                    throwPendingException();
+
+                return juce::var(juce::MemoryBlock(data, size));
+            }
+
+            // Typed arrays copy out just the range of their buffer that they view
+            if (isInstanceOf(v, typedArrayConstructor))
+            {
+                size_t byteOffset = 0, byteLength = 0, bytesPerElement = 0;
+                auto buffer = checked(JS_GetTypedArrayBuffer(context, v, &byteOffset, &byteLength, &bytesPerElement));
+
+                size_t size = 0;
+                const uint8_t *data = JS_GetArrayBuffer(context, &size, buffer.get());
+
+                if (data == nullptr)
+                    throwPendingException();
+
+                jassert(byteOffset + byteLength <= size);
+                return juce::var(juce::MemoryBlock(data + byteOffset, byteLength));
+            }
+
+            // Otherwise treat it as a plain object
+            juce::DynamicObject::Ptr varObj = new juce::DynamicObject();
+
+            JSPropertyEnum *props = nullptr;
+            uint32_t numProps = 0;
+
+            if (JS_GetOwnPropertyNames(context, &props, &numProps, v, JS_GPN_STRING_MASK | JS_GPN_ENUM_ONLY) < 0)
+                throwPendingException();
+
+            const auto freeProps = [&]
+            {
+                for (uint32_t i = 0; i < numProps; ++i)
+                    JS_FreeAtom(context, props[i].atom);
+
+                js_free(context, props);
+            };
+
+            try
+            {
+                for (uint32_t i = 0; i < numProps; ++i)
+                {
+                    auto value = checked(JS_GetProperty(context, v, props[i].atom));
+                    varObj->setProperty(propertyKeys.lookup(context, props[i].atom), valueToVar(value.get()));
+                }
+            }
+            catch (...)
+            {
+                freeProps();
+                throw;
+            }
+
+            freeProps();
+            return varObj.get();
+        }
+
+        bool isInstanceOf(JSValueConst v, const ScopedValue &constructor)
+        {
+            const int result = JS_IsInstanceOf(context, v, constructor.get());
+
+            // A throwing Symbol.hasInstance just means it isn't one of ours
+            if (result < 0)
+                JS_FreeValue(context, JS_GetException(context));
+
+            return result > 0;
+        }
+
+        juce::var arrayToVar(JSValueConst v)
+        {
+            auto lengthValue = checked(JS_GetPropertyStr(context, v, "length"));
+
+            uint32_t numItems = 0;
+            if (JS_ToUint32(context, &numItems, lengthValue.get()) < 0)
+                throwPendingException();
+
+            juce::Array<juce::var> varArray;
+            varArray.ensureStorageAllocated(static_cast<int>(numItems));
+
+            for (uint32_t i = 0; i < numItems; ++i)
+            {
+                auto item = checked(JS_GetPropertyUint32(context, v, i));
+                varArray.add(valueToVar(item.get()));
+            }
+
+            return varArray;
+        }
+
+        juce::var::NativeFunction functionToVar(JSValueConst v)
+        {
+            auto fn = std::make_shared<PersistentFunction>(*this, v);
+
+            return [fn] (const juce::var::NativeFunctionArgs &args) -> juce::var
+            {
+                // If the context was reset or destroyed since, there's nothing to call
+                if (fn->engine == nullptr)
+                    return juce::var();
+
+                return fn->engine->callFunction(fn->fn, std::vector<juce::var>(args.arguments, args.arguments + args.numArguments));
+            };
+        }
+
+        //==============================================================================
+        /** Returns a new value for the given var, which the caller takes over. */
+        JSValue varToValue(const juce::var &v)
+        {
+            if (v.isBool())
+                return JS_NewBool(context, static_cast<bool>(v));
+
+            if (v.isInt())
+                return JS_NewInt32(context, static_cast<int>(v));
+
+            if (v.isInt64())
+                return JS_NewInt64(context, static_cast<juce::int64>(v));
+
+            if (v.isDouble())
+                return JS_NewFloat64(context, static_cast<double>(v));
+
+            if (v.isString())
+            {
+                const auto str = v.toString();
+                return JS_NewStringLen(context, str.toRawUTF8(), str.getNumBytesAsUTF8());
+            }
+
+            if (v.isUndefined())
+                return JS_UNDEFINED;
+
+            if (v.isVoid())
+                return JS_NULL;
+
+            if (v.isArray())
+            {
+                const auto *items = v.getArray();
+                ScopedValue array(context, JS_NewArray(context));
+
+                for (int i = 0; i < items->size(); ++i)
+                    JS_SetPropertyUint32(context, array.get(), static_cast<uint32_t>(i), varToValue(items->getReference(i)));
+
+                return array.release();
+            }
+
+            if (v.isMethod())
+            {
+                return createHostFunction(context, 0, [this, fn = v.getNativeFunction()] (JSContext*, JSValueConst, int argc, JSValueConst *argv)
+                {
+                    std::vector<juce::var> varArgs;
+                    varArgs.reserve(static_cast<size_t>(argc));
+
+                    for (int i = 0; i < argc; ++i)
+                        varArgs.push_back(valueToVar(argv[i]));
+
+                    return varToValue(fn(juce::var::NativeFunctionArgs(juce::var(), varArgs.data(), argc)));
+                });
+            }
+
+            if (v.isObject())
+            {
+                ScopedValue obj(context, JS_NewObject(context));
+
+                if (auto *dynamicObject = v.getDynamicObject())
+                {
+                    for (auto &prop : dynamicObject->getProperties())
+                    {
+                        const auto atom = propertyKeys.lookup(context, prop.name);
+
+                        if (atom != JS_ATOM_NULL)
+                            JS_SetProperty(context, obj.get(), atom, varToValue(prop.value));
+                        else
+                            JS_SetPropertyStr(context, obj.get(), prop.name.getCharPointer(), varToValue(prop.value));
+                    }
+                }
+
+                return obj.release();
+            }
+
+            if (v.isBinaryData())
+            {
+                // The ArrayBuffer gets its own copy, since nothing ties the lifetime of
+                // the var's storage to the JS object
+                const auto *block = v.getBinaryData();
+                return JS_NewArrayBufferCopy(context, static_cast<const uint8_t*>(block->getData()), block->getSize());
+            }
+
+            jassertfalse;
+            return JS_UNDEFINED;
+        }
+
+        //==============================================================================
+        /** Gives a typed native function direct access to the host function arguments. */
+        struct QuickJSCallFrame : public NativeCallFrame
+        {
+            QuickJSCallFrame(Pimpl &e, JSValueConst *a)
+                : engine(e), ctx(e.context), args(a) {}
+
+            ~QuickJSCallFrame() override
+            {
+                for (auto *str : strings)
+                    JS_FreeCString(ctx, str);
+
+                JS_FreeValue(ctx, result);
+            }
+
+            double getNumber(int index) override
+            {
+                double value = 0.0;
+
+                if (JS_ToFloat64(ctx, &value, args[index]) < 0)
+                    engine.throwPendingException();
+
+                return value;
+            }
+
+            bool getBool(int index) override                { return JS_ToBool(ctx, args[index]) > 0; }
+            juce::var getVar(int index) override            { return engine.valueToVar(args[index]); }
+
+            std::string_view getString(int index) override
+            {
+                size_t length = 0;
+                const char *str = JS_ToCStringLen(ctx, &length, args[index]);
+
+                if (str == nullptr)
+                    engine.throwPendingException();
+
+                // Held on to until the frame goes, so that the returned views stay
+                // valid for the duration of the call.
+                strings.push_back(str);
+                return { str, length };
+            }
+
+            void returnNumber(double value) override        { setResult(JS_NewFloat64(ctx, value)); }
+            void returnBool(bool value) override            { setResult(JS_NewBool(ctx, value)); }
+            void returnVar(const juce::var &value) override { setResult(engine.varToValue(value)); }
+
+            void returnString(std::string_view value) override
+            {
+                setResult(JS_NewStringLen(ctx, value.data(), value.size()));
+            }
+
+            void setResult(JSValue value)
+            {
+                JS_FreeValue(ctx, result);
+                result = value;
+            }
+
+            JSValue takeResult()
+            {
+                return std::exchange(result, JS_UNDEFINED);
+            }
+
+            Pimpl                    &engine;
+            JSContext                *ctx;
+            JSValueConst             *args;
+            std::vector<const char*>  strings;
+            JSValue                   result = JS_UNDEFINED;
+        };
+
+        JSValue createTypedHostFunction(int numArgs, TypedNativeFunction fn)
+        {
+            return createHostFunction(context, numArgs, [this, numArgs, f = std::move(fn)] (JSContext *ctx, JSValueConst, int argc, JSValueConst *argv)
+            {
+                if (argc != numArgs)
+                    return JS_ThrowTypeError(ctx, "Native function expected %d arguments but received %d", numArgs, argc);
+
+                QuickJSCallFrame frame(*this, argv);
+                f(frame);
+
+                return frame.takeResult();
+            });
+        }
+
+        //==============================================================================
+        /** Installs the timer globals, whose callbacks live in a table on the JavaScript
+         *  side, and keeps the trampoline that runs them.
+         */
+        void installTimerGlobals()
+        {
+            auto install = checked(JS_Eval(context,
+                                           detail::timerGlobalsScript,
+                                           std::strlen(detail::timerGlobalsScript),
+                                           "<timers>",
+                                           JS_EVAL_TYPE_GLOBAL));
+
+            ScopedValue global(context, JS_GetGlobalObject(context));
+
+            ScopedValue scheduleTimer(context, createHostFunction(context, 2, [this] (JSContext *ctx, JSValueConst, int, JSValueConst *argv)
+            {
+                double timeout = 0.0;
+                JS_ToFloat64(ctx, &timeout, argv[0]);
+
+                return JS_NewInt32(ctx, timeoutsManager->newTimeout(timeout, JS_ToBool(ctx, argv[1]) > 0));
+            }));
+
+            ScopedValue cancelTimer(context, createHostFunction(context, 1, [this] (JSContext *ctx, JSValueConst, int, JSValueConst *argv)
+            {
+                int32_t timerId = 0;
+                JS_ToInt32(ctx, &timerId, argv[0]);
+
+                timeoutsManager->clearTimeout(timerId);
+                return JS_UNDEFINED;
+            }));
+
+            std::vector<JSValueConst> argv { global.get(), scheduleTimer.get(), cancelTimer.get() };
+            runTimersFunction = call(install.get(), argv);
+        }
+
+        //==============================================================================
+        void reset()
+        {
+            destroyContext();
+
+            runtime = JS_NewRuntime();
+
+            // QuickJS measures its stack limit from the stack top recorded for the
+            // runtime, which is that of the thread which created it. An engine may be
+            // created on one thread and run on another, so the stack top is recorded
+            // again on entering each outermost call. The limit stays below the
+            // smallest default thread stack we run on, so that runaway recursion
+            // throws a RangeError rather than overflowing the real stack.
+            JS_SetMaxStackSize(runtime, maxStackBytes);
+            JS_SetInterruptHandler(runtime, &handleInterrupt, this);
+
+            JSClassDef hostFunctionClass {};
+            hostFunctionClass.class_name = "HostFunction";
+            hostFunctionClass.finalizer  = &finalizeHostFunction;
+            JS_NewClass(runtime, getHostFunctionClassId(), &hostFunctionClass);
+
+            context = JS_NewContext(runtime);
+
+            arrayBufferConstructor = resolveObject("ArrayBuffer");
+            // %TypedArray%, the constructor every typed array inherits from
+            const juce::String typedArrayExpression ("Object.getPrototypeOf(Uint8Array)");
+            typedArrayConstructor  = checked(JS_Eval(context,
+                                                     typedArrayExpression.toRawUTF8(),
+                                                     typedArrayExpression.getNumBytesAsUTF8(),
+                                                     "<init>",
+                                                     JS_EVAL_TYPE_GLOBAL));
+
+            timeoutsManager = std::make_unique<TimeoutFunctionManager>([this]() { dispatchTimeouts(); });
+
+            // Quick and dirty console object provide. Could be improved upon.
+            JSValue logFunction = createHostFunction(context, 0, [] (JSContext *ctx, JSValueConst, int argc, JSValueConst *argv)
+            {
+                juce::String logString;
+
+                for (int i = 0; i < argc; ++i)
+                {
+                    logString << toJuceString(ctx, argv[i]);
+                    logString << " ";
+                }
+
+                juce::Logger::writeToLog(logString);
+                return JS_UNDEFINED;
+            });
+
+            ScopedValue global(context, JS_GetGlobalObject(context));
+            ScopedValue console(context, JS_NewObject(context));
+
+            JS_SetPropertyStr(context, console.get(), "log", logFunction);
+
+            JS_SetPropertyStr(context, global.get(), "console", console.release());
+
+            installTimerGlobals();
+        }
+
+        /** Releases everything we hold in the current context before freeing it, since
+         *  QuickJS expects every value to be released by the time its runtime goes.
+         */
+        void destroyContext()
+        {
+            if (context == nullptr)
+                return;
+
+            if (timeoutsManager)
+                timeoutsManager->clear();
+
+            resolvedFunctions.clear();
+            ++generation;
+
+            for (auto *fn : std::vector<PersistentFunction*>(persistentFunctions.begin(), persistentFunctions.end()))
+                fn->release();
+
+            persistentFunctions.clear();
+            propertyKeys.clear(context);
+
+            arrayBufferConstructor = {};
+            typedArrayConstructor  = {};
+            runTimersFunction      = {};
+
+            JS_FreeContext(context);
+            JS_FreeRuntime(runtime);
+
+            context = nullptr;
+            runtime = nullptr;
+        }
+
+        //==============================================================================
+        MemoryStats getMemoryStats() const
+        {
+            JSMemoryUsage usage {};
+            JS_ComputeMemoryUsage(runtime, &usage);
+
+            // QuickJS counts the allocations it holds but not how many it has made, so
+            // we leave the lifetime count empty and track the peak on each query.
+            MemoryStats stats;
+            stats.liveBytes          = static_cast<size_t>(usage.malloc_size);
+            stats.numLiveAllocations = static_cast<size_t>(usage.malloc_count);
+
+            peakBytes = std::max(peakBytes, stats.liveBytes);
+            stats.peakBytes = peakBytes;
+
+            return stats;
+        }
+
+        void collectGarbage()
+        {
+            JS_RunGC(runtime);
+        }
+
+        //==============================================================================
+        void startProfiling(double sampleIntervalMs)
+        {
+            // QuickJS exposes neither a sampler nor the call stack, so all we could
+            // record from its interrupt handler is that something was running.
+            juce::ignoreUnused(sampleIntervalMs);
+            throw Error("Profiling is not supported by the QuickJS backend.");
+        }
+
+        Profile stopProfiling()
+        {
+            return {};
+        }
+
+        bool isProfiling() const
+        {
+            return false;
+        }
+
+        //==============================================================================
+        void setExecutionBudget(double budgetMs)
+        {
+            executionBudget.setLimit(budgetMs);
+        }
+
+        double getExecutionBudget() const
+        {
+            return executionBudget.getLimit();
+        }
+
+        ExecutionStats getExecutionStats() const
+        {
+            return executionBudget.getStats();
+        }
+
+        /** Called by the interpreter every ten thousand or so operations. Returning
+         *  non-zero throws an uncatchable InternalError, unwinding the whole call.
+         */
+        static int handleInterrupt(JSRuntime *rt, void *opaque)
+        {
+            juce::ignoreUnused(rt);
+            return static_cast<Pimpl*>(opaque)->executionBudget.hasExpired() ? 1 : 0;
+        }
+
+        //==============================================================================
+        void debuggerAttach()
+        {
+            throw Error("Debugging is not supported by the QuickJS backend.");
+        }
+
+        void debuggerDetach()
+        {
+            throw Error("Debugging is not supported by the QuickJS backend.");
+        }
+
+        JSRuntime                                *runtime = nullptr;
+        JSContext                                *context = nullptr;
+
+        std::unique_ptr<TimeoutFunctionManager>   timeoutsManager;
+        CallbackDispatcher                        callbackDispatcher;
+        detail::ExecutionBudget                   executionBudget;
+
+        std::vector<ScopedValue>                  resolvedFunctions;
+        std::unordered_set<PersistentFunction*>   persistentFunctions;
+        PropertyKeyTable                          propertyKeys;
+        ScopedValue                               arrayBufferConstructor;
+        ScopedValue                               typedArrayConstructor;
+        ScopedValue                               runTimersFunction;
+
+        int                                       callDepth = 0;
+        juce::uint32                              generation = 0;
+        mutable size_t                            peakBytes = 0;
+    };
+
+    //==============================================================================
+
+}
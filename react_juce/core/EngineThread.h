@@ -0,0 +1,355 @@
+/*
+  ==============================================================================
+
+    EngineThread.h
+    Created: 16 Oct 2026 10:12:00am
+
+  ==============================================================================
+*/
+
+#pragma once
+
+
+namespace reactjuce
+{
+
+    //==============================================================================
+    /** A dedicated thread on which an EcmascriptEngine runs, fed by a queue of jobs.
+     *
+     *  Jobs posted from the message thread go through a lock-free single producer,
+     *  single consumer FIFO. Jobs posted from any other thread, or while the FIFO is
+     *  full, go through a locked overflow list instead, which the engine thread
+     *  drains after the FIFO so that jobs from the message thread keep their order.
+     */
+    class EngineThread : private juce::Thread
+    {
+    public:
+        using Job = std::function<void()>;
+
+        EngineThread()
+            : juce::Thread("React-JUCE Engine")
+        {
+            jobs.resize(static_cast<size_t>(fifo.getTotalSize()));
+        }
+
+        ~EngineThread() override
+        {
+            stop();
+        }
+
+        //==============================================================================
+        void start()
+        {
+            startThread();
+        }
+
+        /** Stops the thread, discarding any jobs which haven't run yet. */
+        void stop()
+        {
+            signalThreadShouldExit();
+            jobPosted.signal();
+            stopThread(-1);
+        }
+
+        /** Returns true if called from the engine thread. */
+        bool isEngineThread() const
+        {
+            return juce::Thread::getCurrentThreadId() == getThreadId();
+        }
+
+        //==============================================================================
+        /** Queues a job to run on the engine thread. */
+        void post (Job job)
+        {
+            if (juce::MessageManager::existsAndIsCurrentThread() && !hasOverflow.load())
+            {
+                const auto scope = fifo.write(1);
+
+                if (scope.blockSize1 > 0)
+                {
+                    jobs[static_cast<size_t>(scope.startIndex1)] = std::move(job);
+                    jobPosted.signal();
+                    return;
+                }
+            }
+
+            {
+                const juce::ScopedLock sl (overflowLock);
+                overflow.push_back(std::move(job));
+                hasOverflow = true;
+            }
+
+            jobPosted.signal();
+        }
+
+        /** Runs the given function on the message thread and waits for its result.
+         *
+         *  Must be called from the engine thread. If the thread is asked to stop while
+         *  waiting, we give up on the result and return undefined, so that a message
+         *  thread waiting on us to stop can't deadlock with us waiting on it.
+         */
+        juce::var callOnMessageThread (std::function<juce::var()> fn)
+        {
+            jassert(isEngineThread());
+
+            struct PendingCall
+            {
+                std::function<juce::var()> fn;
+                juce::var result;
+                std::exception_ptr error;
+                juce::WaitableEvent done;
+            };
+
+            auto call = std::make_shared<PendingCall>();
+            call->fn = std::move(fn);
+
+            juce::MessageManager::callAsync([call]
+            {
+                try {
+                    call->result = call->fn();
+                } catch (...) {
+                    call->error = std::current_exception();
+                }
+
+                call->done.signal();
+            });
+
+            while (!call->done.wait(10))
+                if (threadShouldExit())
+                    return juce::var::undefined();
+
+            if (call->error)
+                std::rethrow_exception(call->error);
+
+            return call->result;
+        }
+
+        //==============================================================================
+        /** Called on the engine thread whenever it has run every job queued so far. */
+        std::function<void()> onIdle;
+
+    private:
+        //==============================================================================
+        void run() override
+        {
+            while (!threadShouldExit())
+            {
+                runPendingJobs();
+
+                if (onIdle && !threadShouldExit())
+                    onIdle();
+
+                jobPosted.wait(-1);
+            }
+        }
+
+        void runPendingJobs()
+        {
+            do
+            {
+                // The FIFO first, since anything in the overflow list was posted after
+                // the FIFO filled up
+                for (;;)
+                {
+                    Job job;
+
+                    {
+                        const auto scope = fifo.read(1);
+
+                        if (scope.blockSize1 == 0)
+                            break;
+
+                        job = std::move(jobs[static_cast<size_t>(scope.startIndex1)]);
+                    }
+
+                    if (threadShouldExit())
+                        return;
+
+                    job();
+                }
+
+                std::vector<Job> overflowJobs;
+
+                {
+                    const juce::ScopedLock sl (overflowLock);
+                    overflowJobs.swap(overflow);
+                    hasOverflow = false;
+                }
+
+                for (auto& job : overflowJobs)
+                {
+                    if (threadShouldExit())
+                        return;
+
+                    job();
+                }
+            }
+            while (fifo.getNumReady() > 0);
+        }
+
+        //==============================================================================
+        juce::AbstractFifo fifo { 1024 };
+        std::vector<Job> jobs;
+
+        juce::CriticalSection overflowLock;
+        std::vector<Job> overflow;
+        std::atomic<bool> hasOverflow { false };
+
+        juce::WaitableEvent jobPosted;
+
+        //==============================================================================
+        JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (EngineThread)
+    };
+
+    namespace detail
+    {
+        //==============================================================================
+        /** Wraps the functions which an engine running on an EngineThread hands over
+         *  to the message thread, such as the event handlers among a view's props.
+         *
+         *  A JavaScript function held in a juce::var may only be called or released
+         *  on the thread that runs its engine. A wrapped function called from any
+         *  other thread posts the call to the engine thread and returns undefined
+         *  without waiting for it. Releasing the last reference to a wrapped function
+         *  likewise posts the release of the function it wraps.
+         *
+         *  Once detached, which happens before the engine thread stops, calls from
+         *  other threads are dropped and releases happen wherever they're made.
+         */
+        class EngineFunctionRouter : public std::enable_shared_from_this<EngineFunctionRouter>
+        {
+        public:
+            using Job = EngineThread::Job;
+
+            EngineFunctionRouter (EngineThread& threadToUse, std::function<void(Job)> postFunction)
+                : thread(&threadToUse), post(std::move(postFunction)) {}
+
+            /** Stops routing calls and releases to the engine thread. */
+            void detach()
+            {
+                const juce::ScopedLock sl (lock);
+                thread = nullptr;
+                post = nullptr;
+            }
+
+            //==============================================================================
+            /** Returns the given value with every function in it wrapped, copying any
+             *  arrays and objects that hold functions.
+             */
+            juce::var wrap (const juce::var& value)
+            {
+                if (!containsFunction(value))
+                    return value;
+
+                if (value.isMethod())
+                    return wrapFunction(value);
+
+                if (auto* array = value.getArray())
+                {
+                    juce::Array<juce::var> wrapped;
+                    wrapped.ensureStorageAllocated(array->size());
+
+                    for (const auto& v : *array)
+                        wrapped.add(wrap(v));
+
+                    return wrapped;
+                }
+
+                auto* wrapped = new juce::DynamicObject();
+
+                for (const auto& prop : value.getDynamicObject()->getProperties())
+                    wrapped->setProperty(prop.name, wrap(prop.value));
+
+                return juce::var(wrapped);
+            }
+
+        private:
+            //==============================================================================
+            /** A function made by the engine, released on the engine thread. */
+            struct RoutedFunction
+            {
+                RoutedFunction (std::weak_ptr<EngineFunctionRouter> r, juce::var f)
+                    : router(std::move(r)), fn(std::move(f)) {}
+
+                ~RoutedFunction()
+                {
+                    if (auto r = router.lock())
+                        r->postUnlessOnEngineThread([f = std::move(fn)]() mutable { f = juce::var(); });
+                }
+
+                std::weak_ptr<EngineFunctionRouter> router;
+                juce::var fn;
+            };
+
+            static bool containsFunction (const juce::var& value)
+            {
+                if (value.isMethod())
+                    return true;
+
+                if (auto* array = value.getArray())
+                    return std::any_of(array->begin(), array->end(), [](const juce::var& v) { return containsFunction(v); });
+
+                if (auto* object = value.getDynamicObject())
+                    for (const auto& prop : object->getProperties())
+                        if (containsFunction(prop.value))
+                            return true;
+
+                return false;
+            }
+
+            juce::var wrapFunction (const juce::var& fn)
+            {
+                auto routed = std::make_shared<RoutedFunction>(weak_from_this(), fn);
+
+                return juce::var::NativeFunction {
+                    [routed](const juce::var::NativeFunctionArgs& args) -> juce::var
+                    {
+                        auto r = routed->router.lock();
+
+                        if (r != nullptr && r->isOnEngineThread())
+                            return std::invoke(routed->fn.getNativeFunction(), args);
+
+                        std::vector<juce::var> argsCopy (args.arguments, args.arguments + args.numArguments);
+
+                        if (r != nullptr)
+                        {
+                            r->postUnlessOnEngineThread([routed, thisObject = args.thisObject, argsCopy = std::move(argsCopy)]
+                            {
+                                const juce::var::NativeFunctionArgs nfArgs (thisObject, argsCopy.data(), static_cast<int>(argsCopy.size()));
+                                std::invoke(routed->fn.getNativeFunction(), nfArgs);
+                            });
+                        }
+
+                        return juce::var();
+                    }
+                };
+            }
+
+            bool isOnEngineThread()
+            {
+                const juce::ScopedLock sl (lock);
+                return thread != nullptr && thread->isEngineThread();
+            }
+
+            /** Posts the job to the engine thread, or drops it if we're on the engine
+             *  thread already or have been detached.
+             */
+            void postUnlessOnEngineThread (Job job)
+            {
+                const juce::ScopedLock sl (lock);
+
+                if (thread != nullptr && post != nullptr && !thread->isEngineThread())
+                    post(std::move(job));
+            }
+
+            //==============================================================================
+            juce::CriticalSection lock;
+            EngineThread* thread = nullptr;
+            std::function<void(Job)> post;
+
+            //==============================================================================
+            JUCE_DECLARE_NON_COPYABLE (EngineFunctionRouter)
+        };
+    }
+
+}
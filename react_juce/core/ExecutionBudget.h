@@ -0,0 +1,147 @@
+/*
+  ==============================================================================
+
+    ExecutionBudget.h
+    Created: 16 Oct 2026 7:35:00pm
+
+  ==============================================================================
+*/
+
+#pragma once
+
+
+namespace reactjuce
+{
+
+    namespace detail
+    {
+        //==============================================================================
+        /** Times each call into an engine against a budget, for the engine backends.
+         *
+         *  Backends mark each of their entry points with a Scope. Only the outermost
+         *  scope counts as a call, so that JavaScript calling back into JavaScript
+         *  through native code shares the budget of the call it started from. Backends
+         *  with an interrupt mechanism ask `hasExpired` from it to abort an overrun.
+         *
+         *  The budget and statistics may be read and written from any thread; the
+         *  scopes are entered on whichever thread runs the engine.
+         */
+        class ExecutionBudget
+        {
+        public:
+            //==============================================================================
+            class Scope
+            {
+            public:
+                explicit Scope (ExecutionBudget& b)
+                    : budget(b)
+                {
+                    if (budget.depth++ == 0)
+                        budget.beginCall();
+                }
+
+                ~Scope()
+                {
+                    if (--budget.depth == 0)
+                        budget.endCall();
+                }
+
+            private:
+                ExecutionBudget& budget;
+
+                JUCE_DECLARE_NON_COPYABLE (Scope)
+            };
+
+            //==============================================================================
+            /** Sets the budget of each call in milliseconds, or zero for no limit. */
+            void setLimit (double limitMs)
+            {
+                limit = juce::jmax(0.0, limitMs);
+            }
+
+            double getLimit() const
+            {
+                return limit;
+            }
+
+            /** Returns true once the current call has overrun its budget, and keeps
+             *  returning true until the call has unwound, as the interrupt mechanisms
+             *  of the backends require.
+             */
+            bool hasExpired()
+            {
+                if (depth == 0 || deadline <= 0.0)
+                    return false;
+
+                if (!expired && juce::Time::getMillisecondCounterHiRes() > deadline)
+                    expired = true;
+
+                return expired;
+            }
+
+            /** Called on entering and leaving each outermost call, for backends which
+             *  enforce the budget by other means. The limit is passed on entering.
+             */
+            std::function<void(double)> onCallStarted;
+            std::function<void()>       onCallFinished;
+
+            //==============================================================================
+            EcmascriptEngine::ExecutionStats getStats() const
+            {
+                EcmascriptEngine::ExecutionStats stats;
+                stats.lastCallMs         = lastCallMs;
+                stats.longestCallMs      = longestCallMs;
+                stats.numCalls           = numCalls;
+                stats.numBudgetsExceeded = numBudgetsExceeded;
+
+                return stats;
+            }
+
+        private:
+            //==============================================================================
+            void beginCall()
+            {
+                const auto limitMs = limit.load();
+
+                startTime = juce::Time::getMillisecondCounterHiRes();
+                deadline  = limitMs > 0.0 ? startTime + limitMs : 0.0;
+                expired   = false;
+
+                if (onCallStarted)
+                    onCallStarted(limitMs);
+            }
+
+            void endCall()
+            {
+                if (onCallFinished)
+                    onCallFinished();
+
+                const auto duration = juce::Time::getMillisecondCounterHiRes() - startTime;
+
+                lastCallMs = duration;
+                longestCallMs = juce::jmax(longestCallMs.load(), duration);
+                ++numCalls;
+
+                if (expired || (deadline > 0.0 && startTime + duration > deadline))
+                    ++numBudgetsExceeded;
+
+                deadline = 0.0;
+                expired  = false;
+            }
+
+            //==============================================================================
+            std::atomic<double> limit { 0.0 };
+
+            int    depth = 0;
+            double startTime = 0.0;
+            double deadline = 0.0;
+            bool   expired = false;
+
+            std::atomic<double> lastCallMs { 0.0 };
+            std::atomic<double> longestCallMs { 0.0 };
+            std::atomic<size_t> numCalls { 0 };
+            std::atomic<size_t> numBudgetsExceeded { 0 };
+        };
+    }
+
+}
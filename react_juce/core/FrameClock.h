@@ -0,0 +1,91 @@
+/*
+  ==============================================================================
+
+    FrameClock.h
+    Created: 16 Oct 2026 4:05:00pm
+
+  ==============================================================================
+*/
+
+#pragma once
+
+
+namespace reactjuce
+{
+
+    //==============================================================================
+    /** A single frame tick on the message thread, shared by everything in a
+     *  ReactApplicationRoot that animates: animation frame callbacks, canvas
+     *  animation, scroll events and layout animations.
+     *
+     *  Driving all of these from the one tick keeps them in phase, so that the
+     *  repaints they trigger land in a single paint per frame. The clock only runs
+     *  while it has listeners.
+     */
+    class FrameClock : private juce::Timer
+    {
+    public:
+        //==============================================================================
+        static constexpr int framesPerSecond = 60;
+
+        /** Receives a callback on every frame while registered with a FrameClock. */
+        struct Listener
+        {
+            virtual ~Listener() = default;
+
+            /** Called on the message thread with the time of the frame, in
+             *  milliseconds, as given by `juce::Time::getMillisecondCounterHiRes`.
+             */
+            virtual void frameCallback (double timestampMs) = 0;
+        };
+
+        FrameClock() = default;
+
+        ~FrameClock() override
+        {
+            stopTimer();
+        }
+
+        //==============================================================================
+        /** Registers the listener for callbacks from the next frame on, starting the
+         *  clock if need be. Adding a listener twice has no further effect.
+         */
+        void addListener (Listener* listener)
+        {
+            JUCE_ASSERT_MESSAGE_THREAD
+
+            listeners.add(listener);
+
+            if (!isTimerRunning())
+                startTimerHz(framesPerSecond);
+        }
+
+        /** Deregisters the listener. Safe to call from within a frame callback. */
+        void removeListener (Listener* listener)
+        {
+            JUCE_ASSERT_MESSAGE_THREAD
+
+            listeners.remove(listener);
+        }
+
+    private:
+        //==============================================================================
+        void timerCallback() override
+        {
+            const auto timestampMs = juce::Time::getMillisecondCounterHiRes();
+
+            listeners.call([timestampMs](Listener& l) { l.frameCallback(timestampMs); });
+
+            // Checked after the callbacks, which may have removed themselves
+            if (listeners.isEmpty())
+                stopTimer();
+        }
+
+        //==============================================================================
+        juce::ListenerList<Listener> listeners;
+
+        //==============================================================================
+        JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (FrameClock)
+    };
+
+}
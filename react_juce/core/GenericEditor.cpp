@@ -48,8 +48,12 @@ namespace reactjuce
         harness.onBeforeAll = [this]() { beforeBundleEvaluated(); };
         harness.onAfterAll = [this]() { afterBundleEvaluated(); };
 
-        // Set up the file watching and kick off the initial render
-        harness.watch(bundleFile);
+        // Set up the file watching and kick off the initial render. Precompiled
+        // bundles skip parsing entirely, so we load those as bytecode.
+        if (bundleFile.hasFileExtension("dukbc;hbc"))
+            harness.watchBytecode(bundleFile);
+        else
+            harness.watch(bundleFile);
 
 #if JUCE_DEBUG
         // We only want to watch for compile changes in debug mode.
@@ -143,33 +147,27 @@ namespace reactjuce
     //==============================================================================
     void GenericEditor::beforeBundleEvaluated()
     {
-        engine->registerNativeMethod(
+        engine->registerNativeFunction<void(juce::String)>(
             "beginParameterChangeGesture",
-            [this](const juce::var::NativeFunctionArgs& args) {
-                if (auto it = parameters.find (args.arguments[0].toString()); it != parameters.cend())
+            [this](const juce::String& paramId) {
+                if (auto it = parameters.find (paramId); it != parameters.cend())
                     it->second->beginChangeGesture();
-
-                return juce::var::undefined();
             }
         );
 
-        engine->registerNativeMethod(
+        engine->registerNativeFunction<void(juce::String, float)>(
             "setParameterValueNotifyingHost",
-            [this](const juce::var::NativeFunctionArgs& args) {
-                if (auto it = parameters.find (args.arguments[0].toString()); it != parameters.cend())
-                    it->second->setValueNotifyingHost(args.arguments[1]);
-
-                return juce::var::undefined();
+            [this](const juce::String& paramId, float value) {
+                if (auto it = parameters.find (paramId); it != parameters.cend())
+                    it->second->setValueNotifyingHost(value);
             }
         );
 
-        engine->registerNativeMethod(
+        engine->registerNativeFunction<void(juce::String)>(
             "endParameterChangeGesture",
-            [this](const juce::var::NativeFunctionArgs& args) {
-                if (auto it = parameters.find (args.arguments[0].toString()); it != parameters.cend())
+            [this](const juce::String& paramId) {
+                if (auto it = parameters.find (paramId); it != parameters.cend())
                     it->second->endChangeGesture();
-
-                return juce::var::undefined();
             }
         );
     }
@@ -172,6 +172,8 @@ namespace reactjuce
     //==============================================================================
     void ImageView::parentHierarchyChanged()
     {
+        View::parentHierarchyChanged();
+
         if (shouldDownloadImage)
         {
             downloadImageAsync(props[sourceProp].toString());
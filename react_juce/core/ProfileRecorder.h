@@ -0,0 +1,91 @@
+/*
+  ==============================================================================
+
+    ProfileRecorder.h
+    Created: 16 Oct 2026 6:20:00pm
+
+  ==============================================================================
+*/
+
+#pragma once
+
+
+namespace reactjuce
+{
+
+    namespace detail
+    {
+        //==============================================================================
+        /** Collects call stack samples into an EcmascriptEngine::Profile for the engine
+         *  backends, interning each distinct frame once.
+         *
+         *  Recording stops once the profile holds `maxNumSamples`, so that a profiler
+         *  left running can't grow without limit.
+         */
+        class ProfileRecorder
+        {
+        public:
+            static constexpr size_t maxNumSamples = 1 << 20;
+
+            explicit ProfileRecorder (double intervalMs)
+                : sampleIntervalMs(juce::jmax(0.1, intervalMs))
+            {
+                profile.startTimeMs = juce::Time::getMillisecondCounterHiRes();
+            }
+
+            //==============================================================================
+            /** Returns true if the next sample should be taken at the given time. */
+            bool isSampleDue (double nowMs) const
+            {
+                return nowMs >= nextSampleTimeMs && profile.samples.size() < maxNumSamples;
+            }
+
+            /** Returns the index of the given frame, adding it to the profile if it's new. */
+            int getFrameIndex (const std::string& functionName, const std::string& fileName, int lineNumber)
+            {
+                auto key = functionName;
+                key.push_back('\0');
+                key += fileName;
+                key.push_back('\0');
+                key += std::to_string(lineNumber);
+
+                if (auto it = frameIndices.find(key); it != frameIndices.end())
+                    return it->second;
+
+                const auto index = static_cast<int>(profile.frames.size());
+
+                profile.frames.push_back({ juce::String::fromUTF8(functionName.data(), static_cast<int>(functionName.size())),
+                                           juce::String::fromUTF8(fileName.data(), static_cast<int>(fileName.size())),
+                                           lineNumber });
+
+                frameIndices.emplace(std::move(key), index);
+                return index;
+            }
+
+            /** Adds a sample of the given stack, outermost call first. */
+            void addSample (double timeMs, std::vector<int> stack)
+            {
+                profile.samples.push_back({ timeMs, std::move(stack) });
+                nextSampleTimeMs = timeMs + sampleIntervalMs;
+            }
+
+            //==============================================================================
+            EcmascriptEngine::Profile finish()
+            {
+                profile.endTimeMs = juce::Time::getMillisecondCounterHiRes();
+                frameIndices.clear();
+
+                return std::move(profile);
+            }
+
+        private:
+            //==============================================================================
+            EcmascriptEngine::Profile profile;
+            std::unordered_map<std::string, int> frameIndices;
+
+            double sampleIntervalMs;
+            double nextSampleTimeMs = 0.0;
+        };
+    }
+
+}
@@ -31,7 +31,7 @@ namespace reactjuce
     {
     public:
         //==============================================================================
-        RawTextView(const juce::String& text) : _text(text) {}
+        RawTextView(const juce::String& text) : View(Kind::RawText), _text(text) {}
 
         //==============================================================================
         void setProperty (const juce::Identifier&, const juce::var&) override
@@ -13,13 +13,37 @@
 namespace reactjuce
 {
 
-    ReactApplicationRoot::ReactApplicationRoot(std::shared_ptr<EcmascriptEngine> ee)
+    ReactApplicationRoot::ReactApplicationRoot(std::shared_ptr<EcmascriptEngine> ee, ThreadingMode threadingMode)
         : viewManager(this)
         , engine(ee)
     {
         JUCE_ASSERT_MESSAGE_THREAD
         jassert(ee != nullptr);
 
+        if (threadingMode == ThreadingMode::DedicatedThread)
+        {
+            engineThread = std::make_unique<EngineThread>();
+            engineThread->onIdle = [this]() { collectGarbageOnEngineThread(); };
+
+            // Functions handed to the views are called and released on the message
+            // thread, so we route those on to the engine thread too
+            functionRouter = std::make_shared<detail::EngineFunctionRouter>(*engineThread, [this](std::function<void()> job) {
+                postToEngineThread(std::move(job));
+            });
+
+            // Timers fire on the message thread, so we forward them on to the
+            // engine thread along with everything else
+            engine->setCallbackDispatcher([this](std::function<void()> callback) {
+                postToEngineThread(std::move(callback));
+            });
+
+            engineThread->start();
+
+            // Finished commits are applied on the frame clock, so we follow it
+            // for as long as the engine thread runs
+            setWantsFrameCallbacks(true);
+        }
+
         bindNativeRenderingHooks();
 
 #if JUCE_DEBUG
@@ -31,50 +55,76 @@ namespace reactjuce
     ReactApplicationRoot::ReactApplicationRoot()
         : ReactApplicationRoot(std::make_shared<EcmascriptEngine>()) {}
 
+    ReactApplicationRoot::~ReactApplicationRoot()
+    {
+        // Our frame clock goes before the View base class that would otherwise
+        // unsubscribe us from it
+        setWantsFrameCallbacks(false);
+
+        if (engineThread != nullptr)
+        {
+            functionRouter->detach();
+            engineThread->stop();
+            engine->setCallbackDispatcher(nullptr);
+        }
+    }
+
     //==============================================================================
-    juce::var ReactApplicationRoot::createViewInstance (const juce::String& viewType)
+    ViewId ReactApplicationRoot::createViewInstance (const juce::String& viewType)
     {
-        return juce::var(viewManager.createViewInstance(viewType));
+        return viewManager.createViewInstance(viewType);
     }
 
-    juce::var ReactApplicationRoot::createTextViewInstance (const juce::String& textValue)
+    ViewId ReactApplicationRoot::createTextViewInstance (const juce::String& textValue)
     {
-        return juce::var(viewManager.createTextViewInstance(textValue));
+        return viewManager.createTextViewInstance(textValue);
     }
 
-    juce::var ReactApplicationRoot::setViewProperty (const ViewId viewId, const juce::String& name, const juce::var& value)
+    void ReactApplicationRoot::setViewProperty (const ViewId viewId, const juce::String& name, const juce::var& value)
     {
         viewManager.setViewProperty(viewId, name, value);
-        return juce::var::undefined();
     }
 
-    juce::var ReactApplicationRoot::setRawTextValue (const ViewId viewId, const juce::String& value)
+    void ReactApplicationRoot::setRawTextValue (const ViewId viewId, const juce::String& value)
     {
         viewManager.setRawTextValue(viewId, value);
-        return juce::var::undefined();
     }
 
-    juce::var ReactApplicationRoot::insertChild (const ViewId parentId, const ViewId childId, int index)
+    void ReactApplicationRoot::insertChild (const ViewId parentId, const ViewId childId, int index)
     {
         viewManager.insertChild(parentId, childId, index);
-        return juce::var::undefined();
     }
 
-    juce::var ReactApplicationRoot::removeChild (const ViewId parentId, const ViewId childId)
+    void ReactApplicationRoot::removeChild (const ViewId parentId, const ViewId childId)
     {
         viewManager.removeChild(parentId, childId);
-        return juce::var::undefined();
     }
 
-    juce::var ReactApplicationRoot::getRootInstanceId()
+    juce::var ReactApplicationRoot::applyMutations (const juce::var& mutations)
     {
-        return juce::var(getViewId());
+        return viewManager.applyMutations(mutations);
     }
 
-    juce::var ReactApplicationRoot::resetAfterCommit()
+    ViewId ReactApplicationRoot::getRootInstanceId()
+    {
+        return getViewId();
+    }
+
+    View* ReactApplicationRoot::getViewByRefId (const juce::Identifier& refId)
+    {
+        JUCE_ASSERT_MESSAGE_THREAD
+
+        return viewManager.getViewByRefId(refId);
+    }
+
+    void ReactApplicationRoot::resetAfterCommit()
     {
         viewManager.performRootShadowTreeLayout();
-        return juce::var::undefined();
+
+        // Having finished the commit, we look for a gap on the message loop before
+        // the next frame in which to collect garbage.
+        if (idleGarbageCollectionEnabled)
+            triggerAsyncUpdate();
     }
 
     //==============================================================================
@@ -97,13 +147,52 @@ namespace reactjuce
     }
 
 #if JUCE_DEBUG
+    namespace
+    {
+        /** Starts the profiler, or stops it and writes out what it recorded both for
+         *  the Chrome DevTools and as collapsed stacks for flame graph tools.
+         */
+        void toggleProfiling(EcmascriptEngine& engine)
+        {
+            try
+            {
+                if (!engine.isProfiling())
+                {
+                    engine.startProfiling();
+                    juce::Logger::writeToLog("React-JUCE: profiling started");
+                    return;
+                }
+
+                const auto profile = engine.stopProfiling();
+                const auto file = juce::File::getSpecialLocation(juce::File::tempDirectory)
+                                      .getNonexistentChildFile("react-juce-profile", ".cpuprofile");
+
+                file.replaceWithText(profile.toCpuProfile());
+                file.withFileExtension(".folded").replaceWithText(profile.toCollapsedStacks());
+
+                juce::Logger::writeToLog("React-JUCE: wrote a profile of " + juce::String(profile.samples.size())
+                                         + " samples to " + file.getFullPathName());
+            }
+            catch (const EcmascriptEngine::Error& err)
+            {
+                juce::Logger::writeToLog("React-JUCE: " + juce::String(err.what()));
+            }
+        }
+    }
+
     bool ReactApplicationRoot::keyPressed(const juce::KeyPress& key)
     {
         const auto startDebugCommand = juce::KeyPress('d', juce::ModifierKeys::commandModifier, 0);
+        const auto toggleProfilingCommand = juce::KeyPress('p', juce::ModifierKeys::commandModifier | juce::ModifierKeys::shiftModifier, 0);
 
-        if (key == startDebugCommand)
+        // The debugger suspends the thread it's attached from, so we only support
+        // it while the engine runs on the message thread.
+        if (key == startDebugCommand && engineThread == nullptr)
             engine->debuggerAttach();
 
+        if (key == toggleProfilingCommand)
+            callOnEngineThread([](EcmascriptEngine& e) { toggleProfiling(e); });
+
         return true;
     }
 #endif
@@ -113,6 +202,12 @@ namespace reactjuce
     {
         JUCE_ASSERT_MESSAGE_THREAD
 
+        if (engineThread != nullptr)
+        {
+            postToEngineThread([this, bundle] { engine->evaluate(bundle); });
+            return juce::var();
+        }
+
         try
         {
             return engine->evaluate(bundle);
@@ -128,6 +223,12 @@ namespace reactjuce
     {
         JUCE_ASSERT_MESSAGE_THREAD
 
+        if (engineThread != nullptr)
+        {
+            postToEngineThread([this, code] { engine->evaluateBytecode(code); });
+            return juce::var();
+        }
+
         try
         {
             return engine->evaluateBytecode(code);
@@ -139,12 +240,50 @@ namespace reactjuce
         }
     }
 
+    juce::var ReactApplicationRoot::evaluateBytecode(const void* data, size_t size, const juce::String& name)
+    {
+        JUCE_ASSERT_MESSAGE_THREAD
+
+        if (engineThread != nullptr)
+        {
+            postToEngineThread([this, data, size, name] { engine->evaluateBytecode(data, size, name); });
+            return juce::var();
+        }
+
+        try
+        {
+            return engine->evaluateBytecode(data, size, name);
+        }
+        catch (const EcmascriptEngine::Error& err)
+        {
+            handleRuntimeError(err);
+            return juce::var();
+        }
+    }
+
     //==============================================================================
     void ReactApplicationRoot::registerViewType(const juce::String& typeId, ViewManager::ViewFactory f)
     {
         viewManager.registerViewType(typeId, f);
     }
 
+    void ReactApplicationRoot::setRecyclingPoolCapacity(const juce::String& typeId, size_t capacity)
+    {
+        JUCE_ASSERT_MESSAGE_THREAD
+
+        viewManager.setRecyclingPoolCapacity(typeId, capacity);
+    }
+
+    ViewManager::RecyclingPoolStats ReactApplicationRoot::getRecyclingPoolStats(const juce::String& typeId) const
+    {
+        return viewManager.getRecyclingPoolStats(typeId);
+    }
+
+    ViewManager::TeardownStats ReactApplicationRoot::getTeardownStats() const
+    {
+        return viewManager.getTeardownStats();
+    }
+
     //==============================================================================
     void ReactApplicationRoot::handleRuntimeError(const EcmascriptEngine::Error& err)
     {
@@ -185,12 +324,45 @@ namespace reactjuce
     void ReactApplicationRoot::reset()
     {
         viewManager.clearViewTables();
-        engine->reset();
         errorText = nullptr;
+
+        if (engineThread != nullptr)
+        {
+            const int generation = ++resetGeneration;
+
+            {
+                const juce::ScopedLock sl (pendingCommitsLock);
+                pendingCommits.clear();
+            }
+
+            postToEngineThread([this, generation] {
+                engineGeneration = generation;
+                inProgressCommit = {};
+                animationFrameCallbacks.clear();
+                engine->reset();
+            });
+
+            return;
+        }
+
+        animationFrameCallbacks.clear();
+        engine->reset();
     }
 
     void ReactApplicationRoot::bindNativeRenderingHooks()
     {
+        if (engineThread != nullptr)
+        {
+            postToEngineThread([this] {
+                bindEngineThreadRenderingHooks();
+                bindAnimationFrameHooks();
+            });
+
+            return;
+        }
+
+        bindAnimationFrameHooks();
+
         const auto ns = "__NativeBindings__";
 
         engine->registerNativeProperty(ns, juce::JSON::parse("{}"));
@@ -205,14 +377,15 @@ namespace reactjuce
             return viewManager.invokeViewMethod(viewId, method, methodArgs);
         });
 
-        addMethodBinding<1>(ns, "createViewInstance", &ReactApplicationRoot::createViewInstance);
-        addMethodBinding<1>(ns, "createTextViewInstance", &ReactApplicationRoot::createTextViewInstance);
-        addMethodBinding<3>(ns, "setViewProperty", &ReactApplicationRoot::setViewProperty);
-        addMethodBinding<2>(ns, "setRawTextValue", &ReactApplicationRoot::setRawTextValue);
-        addMethodBinding<3>(ns, "insertChild", &ReactApplicationRoot::insertChild);
-        addMethodBinding<2>(ns, "removeChild", &ReactApplicationRoot::removeChild);
-        addMethodBinding<0>(ns, "getRootInstanceId", &ReactApplicationRoot::getRootInstanceId);
-        addMethodBinding<0>(ns, "resetAfterCommit", &ReactApplicationRoot::resetAfterCommit);
+        addMethodBinding(ns, "createViewInstance", &ReactApplicationRoot::createViewInstance);
+        addMethodBinding(ns, "createTextViewInstance", &ReactApplicationRoot::createTextViewInstance);
+        addMethodBinding(ns, "setViewProperty", &ReactApplicationRoot::setViewProperty);
+        addMethodBinding(ns, "setRawTextValue", &ReactApplicationRoot::setRawTextValue);
+        addMethodBinding(ns, "insertChild", &ReactApplicationRoot::insertChild);
+        addMethodBinding(ns, "removeChild", &ReactApplicationRoot::removeChild);
+        addMethodBinding(ns, "applyMutations", &ReactApplicationRoot::applyMutations);
+        addMethodBinding(ns, "getRootInstanceId", &ReactApplicationRoot::getRootInstanceId);
+        addMethodBinding(ns, "resetAfterCommit", &ReactApplicationRoot::resetAfterCommit);
     }
 
     juce::ThreadPool&  ReactApplicationRoot::getThreadPool()
@@ -220,4 +393,327 @@ namespace reactjuce
         return threadPool;
     }
 
+    FrameClock* ReactApplicationRoot::getFrameClock()
+    {
+        return &frameClock;
+    }
+
+    //==============================================================================
+    void ReactApplicationRoot::bindAnimationFrameHooks()
+    {
+        engine->registerNativeFunction<int(juce::var)>("requestAnimationFrame", [this](const juce::var& callback) {
+            if (!callback.isMethod())
+                throw EcmascriptEngine::Error("requestAnimationFrame requires a callback");
+
+            const int id = nextAnimationFrameId++;
+            animationFrameCallbacks.push_back({ id, callback });
+            animationFrameRequested = true;
+
+            // On the engine thread we're following the frame clock already
+            if (engineThread == nullptr)
+                setWantsFrameCallbacks(true);
+
+            return id;
+        });
+
+        engine->registerNativeFunction<void(int)>("cancelAnimationFrame", [this](int id) {
+            animationFrameCallbacks.erase(std::remove_if(animationFrameCallbacks.begin(),
+                                                         animationFrameCallbacks.end(),
+                                                         [id](const auto& cb) { return cb.id == id; }),
+                                          animationFrameCallbacks.end());
+        });
+    }
+
+    void ReactApplicationRoot::frameCallback (double timestampMs)
+    {
+        if (engineThread != nullptr)
+            applyPendingCommits();
+
+        if (animationFrameRequested.exchange(false) && !errorText)
+            runAnimationFrames(timestampMs);
+
+        // Without an engine thread, we only need the clock while frames are requested
+        if (engineThread == nullptr && !animationFrameRequested)
+            setWantsFrameCallbacks(false);
+    }
+
+    void ReactApplicationRoot::runAnimationFrames (double timestampMs)
+    {
+        if (engineThread != nullptr)
+        {
+            postToEngineThread([this, timestampMs] { invokeAnimationFrames(timestampMs); });
+            return;
+        }
+
+        try {
+            invokeAnimationFrames(timestampMs);
+        } catch (const EcmascriptEngine::Error& err) {
+            handleRuntimeError(err);
+        }
+    }
+
+    void ReactApplicationRoot::invokeAnimationFrames (double timestampMs)
+    {
+        // Callbacks requested from within these ones wait for the next frame
+        std::vector<AnimationFrameCallback> callbacks;
+        callbacks.swap(animationFrameCallbacks);
+
+        const juce::var timestamp (timestampMs);
+
+        for (const auto& cb : callbacks)
+            std::invoke(cb.callback.getNativeFunction(), juce::var::NativeFunctionArgs(juce::var(), &timestamp, 1));
+    }
+
+    void ReactApplicationRoot::setIdleGarbageCollectionEnabled (bool shouldBeEnabled, double budgetMs)
+    {
+        JUCE_ASSERT_MESSAGE_THREAD
+
+        idleGarbageCollectionEnabled = shouldBeEnabled;
+        idleGarbageCollectionBudgetMs = budgetMs;
+
+        if (!shouldBeEnabled)
+            cancelPendingUpdate();
+    }
+
+    void ReactApplicationRoot::handleAsyncUpdate()
+    {
+        if (errorText || engineThread != nullptr)
+            return;
+
+        const auto now = juce::Time::getMillisecondCounterHiRes();
+
+        if (now - lastIdleCollectionTime < idleCollectionIntervalMs)
+            return;
+
+        if (engine->collectGarbage(idleGarbageCollectionBudgetMs))
+            lastIdleCollectionTime = now;
+    }
+
+    void ReactApplicationRoot::collectGarbageOnEngineThread()
+    {
+        // The engine thread's equivalent of handleAsyncUpdate: it goes idle once it
+        // has run every queued job, which is our gap between commits.
+        if (!idleGarbageCollectionEnabled || !engineCommittedSinceIdle.exchange(false))
+            return;
+
+        const auto now = juce::Time::getMillisecondCounterHiRes();
+
+        if (now - lastIdleCollectionTime < idleCollectionIntervalMs)
+            return;
+
+        if (engine->collectGarbage(idleGarbageCollectionBudgetMs))
+            lastIdleCollectionTime = now;
+    }
+
+    //==============================================================================
+    void ReactApplicationRoot::callOnEngineThread (std::function<void(EcmascriptEngine&)> fn)
+    {
+        if (engineThread == nullptr)
+        {
+            fn(*engine);
+            return;
+        }
+
+        postToEngineThread([this, fn = std::move(fn)] { fn(*engine); });
+    }
+
+    void ReactApplicationRoot::postToEngineThread (std::function<void()> job)
+    {
+        jassert(engineThread != nullptr);
+
+        engineThread->post([this, job = std::move(job)]
+        {
+            try
+            {
+                job();
+            }
+            catch (const EcmascriptEngine::Error& err)
+            {
+                reportEngineThreadError(err);
+            }
+        });
+    }
+
+    void ReactApplicationRoot::reportEngineThreadError (const EcmascriptEngine::Error& err)
+    {
+        juce::Component::SafePointer<ReactApplicationRoot> safeThis (this);
+
+        juce::MessageManager::callAsync([safeThis, err]
+        {
+            if (safeThis == nullptr)
+                return;
+
+            if (safeThis->onRuntimeError)
+                safeThis->onRuntimeError(err);
+            else
+                safeThis->handleRuntimeError(err);
+        });
+    }
+
+    //==============================================================================
+    void ReactApplicationRoot::bindEngineThreadRenderingHooks()
+    {
+        // Here the rendering methods only record mutations into the commit in
+        // progress, which is handed over to the message thread by resetAfterCommit.
+        // The ids of new views are reserved up front, so that the reconciler can
+        // refer to views which won't exist until the commit is applied.
+        const auto ns = "__NativeBindings__";
+
+        engine->registerNativeProperty(ns, juce::JSON::parse("{}"));
+
+        engine->registerNativeMethod(ns, "invokeViewMethod", [this](const juce::var::NativeFunctionArgs& args) -> juce::var
+        {
+            jassert(args.numArguments >= 2);
+            const ViewId       viewId = args.arguments[0];
+            const juce::String method = args.arguments[1];
+
+            juce::Array<juce::var> methodArgs;
+
+            for (int i = 2; i < args.numArguments; ++i)
+                methodArgs.add(functionRouter->wrap(args.arguments[i]));
+
+            const juce::var thisObject = functionRouter->wrap(args.thisObject);
+
+            // View methods need the view itself, so we have to wait for the message
+            // thread, which first catches up on any commits it hasn't applied yet.
+            juce::Component::SafePointer<ReactApplicationRoot> safeThis (this);
+
+            return engineThread->callOnMessageThread([safeThis, viewId, method, methodArgs, thisObject]() -> juce::var
+            {
+                if (safeThis == nullptr)
+                    return juce::var();
+
+                safeThis->applyPendingCommits();
+
+                const juce::var::NativeFunctionArgs nativeArgs(thisObject, methodArgs.begin(), methodArgs.size());
+                return safeThis->viewManager.invokeViewMethod(viewId, method, nativeArgs);
+            });
+        });
+
+        using MutationType = ViewManager::MutationType;
+        auto op = [](MutationType type) { return juce::var(static_cast<int>(type)); };
+
+        engine->registerNativeFunction<ViewId(juce::String)>(ns, "createViewInstance", [this, op](const juce::String& viewType) {
+            return appendPendingCreation({ op(MutationType::CreateView), viewType });
+        });
+
+        engine->registerNativeFunction<ViewId(juce::String)>(ns, "createTextViewInstance", [this, op](const juce::String& textValue) {
+            return appendPendingCreation({ op(MutationType::CreateTextView), textValue });
+        });
+
+        engine->registerNativeFunction<void(ViewId, juce::String, juce::var)>(ns, "setViewProperty", [this, op](ViewId viewId, const juce::String& name, const juce::var& value) {
+            appendPendingMutation({ op(MutationType::SetProperty), viewId, name, functionRouter->wrap(value) });
+        });
+
+        engine->registerNativeFunction<void(ViewId, juce::String)>(ns, "setRawTextValue", [this, op](ViewId viewId, const juce::String& value) {
+            appendPendingMutation({ op(MutationType::SetRawTextValue), viewId, value });
+        });
+
+        engine->registerNativeFunction<void(ViewId, ViewId, int)>(ns, "insertChild", [this, op](ViewId parentId, ViewId childId, int index) {
+            appendPendingMutation({ op(MutationType::InsertChild), parentId, childId, index });
+        });
+
+        engine->registerNativeFunction<void(ViewId, ViewId)>(ns, "removeChild", [this, op](ViewId parentId, ViewId childId) {
+            appendPendingMutation({ op(MutationType::RemoveChild), parentId, childId });
+        });
+
+        engine->registerNativeFunction<juce::var(juce::var)>(ns, "applyMutations", [this](const juce::var& mutations) {
+            const auto* ops = mutations.getArray();
+            int numCreated = 0;
+
+            try {
+                numCreated = ViewManager::countCreatedViews(mutations);
+            } catch (const std::invalid_argument& e) {
+                throw EcmascriptEngine::Error(e.what());
+            }
+
+            juce::Array<juce::var> createdIds;
+
+            for (int i = 0; i < numCreated; ++i)
+            {
+                const ViewId id = viewManager.reserveViewId();
+                inProgressCommit.reservedIds.push_back(id);
+                createdIds.add(id);
+            }
+
+            // Property values are the only operands which may hold functions, and
+            // none of the others are costly to check
+            if (ops != nullptr)
+                for (const auto& v : *ops)
+                    inProgressCommit.mutations.add(functionRouter->wrap(v));
+
+            return juce::var(createdIds);
+        });
+
+        engine->registerNativeFunction<ViewId()>(ns, "getRootInstanceId", [this]() {
+            return getViewId();
+        });
+
+        engine->registerNativeFunction<void()>(ns, "resetAfterCommit", [this]() {
+            if (inProgressCommit.mutations.isEmpty())
+                return;
+
+            inProgressCommit.generation = engineGeneration;
+
+            {
+                const juce::ScopedLock sl (pendingCommitsLock);
+                pendingCommits.push_back(std::move(inProgressCommit));
+            }
+
+            inProgressCommit = {};
+            engineCommittedSinceIdle = true;
+        });
+    }
+
+    void ReactApplicationRoot::appendPendingMutation (std::initializer_list<juce::var> op)
+    {
+        for (const auto& v : op)
+            inProgressCommit.mutations.add(v);
+    }
+
+    ViewId ReactApplicationRoot::appendPendingCreation (std::initializer_list<juce::var> op)
+    {
+        const ViewId id = viewManager.reserveViewId();
+
+        inProgressCommit.reservedIds.push_back(id);
+        appendPendingMutation(op);
+
+        return id;
+    }
+
+    void ReactApplicationRoot::applyPendingCommits()
+    {
+        JUCE_ASSERT_MESSAGE_THREAD
+
+        std::vector<PendingCommit> commits;
+
+        {
+            const juce::ScopedLock sl (pendingCommitsLock);
+            commits.swap(pendingCommits);
+        }
+
+        if (commits.empty() || errorText)
+            return;
+
+        try
+        {
+            for (auto& commit : commits)
+            {
+                // Commits made before the engine caught up with our last reset belong
+                // to views we've already torn down
+                if (commit.generation != resetGeneration)
+                    continue;
+
+                viewManager.applyMutations(juce::var(std::move(commit.mutations)), commit.reservedIds);
+            }
+        }
+        catch (const std::invalid_argument& e)
+        {
+            handleRuntimeError(EcmascriptEngine::Error(e.what()));
+            return;
+        }
+
+        viewManager.performRootShadowTreeLayout();
+    }
+
 }
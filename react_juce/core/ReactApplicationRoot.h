@@ -10,7 +10,9 @@
 #pragma once
 
 #include "EcmascriptEngine.h"
+#include "EngineThread.h"
 #include "FileWatcher.h"
+#include "FrameClock.h"
 #include "View.h"
 #include "ViewManager.h"
 
@@ -32,24 +34,50 @@ namespace reactjuce
      *  Users can hit CTRL-D/CMD-D when the ReactApplicationRoot component has focus,
      *  causing the application to suspend execution and await connection from a debug client.
      *  See the documentation for details on setting up and connecting a debugger.
+     *
+     *  Optionally, the EcmascriptEngine may be given a dedicated thread of its own,
+     *  so that reconciliation never blocks painting or the host's UI. In that mode,
+     *  events are posted to the engine thread, and the mutations of each commit are
+     *  queued up and applied to the ViewManager on the message thread as one batch
+     *  per frame. The engine is then only to be touched through `callOnEngineThread`.
+     *  Functions passed to the views, such as event handlers, are posted to the
+     *  engine thread when called and return undefined, so a CanvasView's `onDraw`
+     *  draws nothing in this mode.
+     *
+     *  Everything in the app that animates follows the root's FrameClock, which also
+     *  drives `requestAnimationFrame` in the engine.
      */
-    class ReactApplicationRoot : public View
+    class ReactApplicationRoot : public View, private juce::AsyncUpdater
     {
     public:
         //==============================================================================
-        explicit ReactApplicationRoot(std::shared_ptr<EcmascriptEngine> ee);
+        enum class ThreadingMode
+        {
+            MessageThread,   // The engine runs on the message thread
+            DedicatedThread, // The engine runs on its own EngineThread
+        };
+
+        explicit ReactApplicationRoot(std::shared_ptr<EcmascriptEngine> ee,
+                                      ThreadingMode threadingMode = ThreadingMode::MessageThread);
         ReactApplicationRoot();
+        ~ReactApplicationRoot() override;
 
         //==============================================================================
         /** The main rendering interface. */
-        juce::var createViewInstance (const juce::String& viewType);
-        juce::var createTextViewInstance (const juce::String& textValue);
-        juce::var setViewProperty (const ViewId viewId, const juce::String& name, const juce::var& value);
-        juce::var setRawTextValue (const ViewId viewId, const juce::String& value);
-        juce::var insertChild (const ViewId parentId, const ViewId childId, int index);
-        juce::var removeChild (const ViewId parentId, const ViewId childId);
-        juce::var getRootInstanceId();
-        juce::var resetAfterCommit();
+        ViewId    createViewInstance (const juce::String& viewType);
+        ViewId    createTextViewInstance (const juce::String& textValue);
+        void      setViewProperty (const ViewId viewId, const juce::String& name, const juce::var& value);
+        void      setRawTextValue (const ViewId viewId, const juce::String& value);
+        void      insertChild (const ViewId parentId, const ViewId childId, int index);
+        void      removeChild (const ViewId parentId, const ViewId childId);
+        juce::var applyMutations (const juce::var& mutations);
+        ViewId    getRootInstanceId();
+        void      resetAfterCommit();
+
+        /** Returns the view React rendered with the given `refId` prop, or nullptr
+         *  if there is none. Only to be called on the message thread.
+         */
+        View*     getViewByRefId (const juce::Identifier& refId);
 
         //==============================================================================
         /** Override the default resized behavior. */
@@ -59,7 +87,10 @@ namespace reactjuce
         void paint(juce::Graphics& g) override;
 
 #if JUCE_DEBUG
-        /** In debug builds, we add a keypress handler to toggle debugging. */
+        /** In debug builds, we add a keypress handler to start debugging, on Cmd+D,
+         *  and to start and stop the profiler, on Cmd+Shift+P. Profiles are written to
+         *  the temp directory.
+         */
         bool keyPressed(const juce::KeyPress& key) override;
 #endif
 
@@ -78,9 +109,26 @@ namespace reactjuce
          */
         juce::var evaluateBytecode(const juce::File &code);
 
+        /** Overload for evaluating precompiled bytecode held in memory, such as
+         *  BinaryData, which must outlive the process. See
+         *  EcmascriptEngine::evaluateBytecode.
+         */
+        juce::var evaluateBytecode(const void* data, size_t size, const juce::String& name);
+
         /** Install a custom view type into the view manager. */
         void registerViewType(const juce::String& typeId, ViewManager::ViewFactory f);
 
+        /** Enables recycling of removed views of a registered type. See
+         *  ViewManager::setRecyclingPoolCapacity.
+         */
+        void setRecyclingPoolCapacity(const juce::String& typeId, size_t capacity);
+
+        /** Returns the state of the recycling pool of a registered type. */
+        ViewManager::RecyclingPoolStats getRecyclingPoolStats(const juce::String& typeId) const;
+
+        /** Returns the state of the queue of removed views awaiting destruction. */
+        ViewManager::TeardownStats getTeardownStats() const;
+
         /** Dispatches an event through the EventBridge. */
         template <typename... T>
         void dispatchEvent (const juce::String& eventType, T... args)
@@ -93,8 +141,21 @@ namespace reactjuce
             if (errorText)
                 return;
 
+            if (engineThread != nullptr)
+            {
+                std::vector<juce::var> vargs { juce::var(eventType), juce::var(args)... };
+
+                postToEngineThread([this, vargs = std::move(vargs)] {
+                    engine->invoke(getBridgeFunction(dispatchEventHandle, "__NativeBindings__.dispatchEvent"), vargs);
+                });
+
+                return;
+            }
+
             try {
-                engine->invoke("__NativeBindings__.dispatchEvent", eventType, std::forward<T>(args)...);
+                engine->invoke(getBridgeFunction(dispatchEventHandle, "__NativeBindings__.dispatchEvent"),
+                               eventType,
+                               std::forward<T>(args)...);
             } catch (const EcmascriptEngine::Error& err) {
                 handleRuntimeError(err);
             }
@@ -112,8 +173,20 @@ namespace reactjuce
             if (errorText)
                 return;
 
+            if (engineThread != nullptr)
+            {
+                std::vector<juce::var> vargs { juce::var(args)... };
+
+                postToEngineThread([this, vargs = std::move(vargs)] {
+                    engine->invoke(getBridgeFunction(dispatchViewEventHandle, "__NativeBindings__.dispatchViewEvent"), vargs);
+                });
+
+                return;
+            }
+
             try {
-                engine->invoke("__NativeBindings__.dispatchViewEvent", std::forward<T>(args)...);
+                engine->invoke(getBridgeFunction(dispatchViewEventHandle, "__NativeBindings__.dispatchViewEvent"),
+                               std::forward<T>(args)...);
             } catch (const EcmascriptEngine::Error& err) {
                 handleRuntimeError(err);
             }
@@ -123,6 +196,22 @@ namespace reactjuce
         /** Displays the red error screen for the given error. */
         void handleRuntimeError(const EcmascriptEngine::Error& err);
 
+        /** When running on a dedicated engine thread, errors raised there are reported
+         *  to this callback on the message thread if set, or else to `handleRuntimeError`.
+         *
+         *  Release builds should set this, since `handleRuntimeError` rethrows the
+         *  error there and would have nowhere to throw it to.
+         */
+        std::function<void(const EcmascriptEngine::Error&)> onRuntimeError;
+
+        /** Runs the given function against the EcmascriptEngine, on the engine thread
+         *  when there is one, or else immediately.
+         *
+         *  This is the only safe way to touch the engine directly, e.g. to register
+         *  native functions, when running on a dedicated engine thread.
+         */
+        void callOnEngineThread (std::function<void(EcmascriptEngine&)> fn);
+
         /** Clears the internal EcmascriptEngine and view table. */
         void reset();
 
@@ -136,37 +225,80 @@ namespace reactjuce
         /** Get a handle to the internal threadpool. */
         juce::ThreadPool& getThreadPool();
 
+        /** Returns the frame clock shared by every view in this root. */
+        FrameClock* getFrameClock() override;
+
+        /** Enables or disables collecting garbage in the gap on the message loop after
+         *  each commit, with the given budget in milliseconds per collection.
+         *
+         *  Collections are spaced at least `idleCollectionIntervalMs` apart, and skipped
+         *  while they're expected to overrun the budget. See
+         *  `EcmascriptEngine::collectGarbage`.
+         */
+        void setIdleGarbageCollectionEnabled (bool shouldBeEnabled, double budgetMs = 4.0);
+
     private:
         //==============================================================================
-        template <int NumParams, typename MethodType>
-        juce::var invokeFromNativeFunction (MethodType method, const juce::var::NativeFunctionArgs& args)
+        void handleAsyncUpdate() override;
+        void frameCallback (double timestampMs) override;
+
+        //==============================================================================
+        /** A batch of mutations built up on the engine thread, along with the ids
+         *  reserved for the views it creates.
+         */
+        struct PendingCommit
         {
-            static_assert (NumParams <= 4);
+            juce::Array<juce::var> mutations;
+            std::vector<ViewId> reservedIds;
+            int generation = 0;
+        };
+
+        void bindEngineThreadRenderingHooks();
+        void appendPendingMutation (std::initializer_list<juce::var> op);
+        ViewId appendPendingCreation (std::initializer_list<juce::var> op);
+        void applyPendingCommits();
 
-            if (args.numArguments != NumParams)
-                return juce::var::undefined();
+        void bindAnimationFrameHooks();
+        void runAnimationFrames (double timestampMs);
+        void invokeAnimationFrames (double timestampMs);
 
-            if constexpr (NumParams == 0)    return (this->*method)();
-            if constexpr (NumParams == 1)    return (this->*method)(args.arguments[0]);
-            if constexpr (NumParams == 2)    return (this->*method)(args.arguments[0], args.arguments[1]);
-            if constexpr (NumParams == 3)    return (this->*method)(args.arguments[0], args.arguments[1], args.arguments[2]);
-            if constexpr (NumParams == 4)    return (this->*method)(args.arguments[0], args.arguments[1], args.arguments[2], args.arguments[3]);
+        void postToEngineThread (std::function<void()> job);
+        void reportEngineThreadError (const EcmascriptEngine::Error& err);
+        void collectGarbageOnEngineThread();
 
-            return {};
+        //==============================================================================
+        /** Returns the cached handle to the named bridge function, resolving it again
+         *  whenever the engine has been reset since it was last resolved.
+         */
+        const EcmascriptEngine::FunctionHandle& getBridgeFunction (EcmascriptEngine::FunctionHandle& handle, const char* name)
+        {
+            if (!engine->isValid(handle))
+                handle = engine->resolve(name);
+
+            return handle;
         }
 
-        template <int NumParams, typename MethodType>
-        void addMethodBinding (const char* ns, const char* name, MethodType method) {
-            engine->registerNativeMethod(
+        //==============================================================================
+        /** Binds a rendering method to the named function on the given namespace
+         *  object, reading its arguments directly from the engine with the types of
+         *  the method's parameters.
+         */
+        template <typename R, typename... Args>
+        void addMethodBinding (const char* ns, const char* name, R (ReactApplicationRoot::*method)(Args...)) {
+            engine->registerNativeFunction<R(std::decay_t<Args>...)>(
                 ns,
                 name,
-                [this, method] (const juce::var::NativeFunctionArgs& args) -> juce::var {
-                    return invokeFromNativeFunction<NumParams>(method, args);
+                [this, method] (std::decay_t<Args>... args) -> R {
+                    return (this->*method)(args...);
                 }
             );
         }
 
         //==============================================================================
+        // Declared ahead of the ViewManager, since the views it owns subscribe to the
+        // clock until they're destroyed.
+        FrameClock frameClock;
+
         ViewManager viewManager;
 
         // This will be used by components to asynchronously download content from an web url.
@@ -175,6 +307,51 @@ namespace reactjuce
         std::shared_ptr<EcmascriptEngine>       engine;
         std::unique_ptr<juce::AttributedString> errorText;
 
+        // Cached handles to the bridge functions installed by the bundle, which
+        // are invoked for every event we dispatch.
+        EcmascriptEngine::FunctionHandle dispatchEventHandle;
+        EcmascriptEngine::FunctionHandle dispatchViewEventHandle;
+
+        static constexpr double idleCollectionIntervalMs = 500.0;
+
+        std::atomic<bool>   idleGarbageCollectionEnabled { false };
+        std::atomic<double> idleGarbageCollectionBudgetMs { 4.0 };
+        double lastIdleCollectionTime = 0.0;
+
+        // Only used in ThreadingMode::DedicatedThread. The mutations of the commit in
+        // progress are only ever touched by the engine thread; finished commits are
+        // handed to the message thread under the lock.
+        PendingCommit inProgressCommit;
+        std::atomic<bool> engineCommittedSinceIdle { false };
+
+        // Callbacks waiting on the next animation frame. Only touched by the thread the
+        // engine runs on.
+        struct AnimationFrameCallback
+        {
+            int id;
+            juce::var callback;
+        };
+
+        std::vector<AnimationFrameCallback> animationFrameCallbacks;
+        int nextAnimationFrameId = 1;
+        std::atomic<bool> animationFrameRequested { false };
+
+        // Bumped by each reset on the message thread, so that commits made by the
+        // engine before it caught up with the reset can be told apart and dropped.
+        int resetGeneration = 0;
+        int engineGeneration = 0;
+
+        juce::CriticalSection pendingCommitsLock;
+        std::vector<PendingCommit> pendingCommits;
+
+        // Only used in ThreadingMode::DedicatedThread. Wraps the functions passed to
+        // the message thread, so that they're called and released on the engine thread.
+        std::shared_ptr<detail::EngineFunctionRouter> functionRouter;
+
+        // Declared last so that the thread is stopped before anything it uses is
+        // destroyed, although the destructor stops it explicitly too.
+        std::unique_ptr<EngineThread> engineThread;
+
         //==============================================================================
         JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ReactApplicationRoot)
     };
@@ -26,14 +26,14 @@ namespace reactjuce
     //==============================================================================
     ScrollView::ScrollView()
     {
-        // Use a default scrollEvent rate of 30Hz.
-        // This is prop configurable
-        startTimerHz(30);
-
+        // Scroll events are coalesced and flushed on the next frame of the root's
+        // frame clock
         viewport.onAreaChanged([this](const juce::Rectangle<int>& area)
         {
             lastScrollEvent.event = detail::makeScrollEventObject(area.getY(), area.getX());
             lastScrollEvent.dirty = true;
+
+            setWantsFrameCallbacks(true);
         });
 
         addAndMakeVisible(viewport);
@@ -123,8 +123,13 @@ namespace reactjuce
         View::resized();
     }
 
-    void ScrollView::timerCallback()
+    void ScrollView::frameCallback (double timestampMs)
     {
+        juce::ignoreUnused(timestampMs);
+
+        // We only need the next frame after each scroll
+        setWantsFrameCallbacks(false);
+
         if (lastScrollEvent.dirty)
         {
             if (props.contains(onScrollProp) && props[onScrollProp].isMethod())
@@ -22,7 +22,6 @@ namespace reactjuce
         methods delegate to a single child juce::Viewport.
      */
     class ScrollView : public View
-                     , private juce::Timer
     {
         //==============================================================================
         class ScrollViewViewport : public juce::Viewport
@@ -79,7 +78,7 @@ namespace reactjuce
 
     private:
         //==============================================================================
-        void timerCallback() override;
+        void frameCallback (double timestampMs) override;
         void exportNativeMethods();
 
         //==============================================================================
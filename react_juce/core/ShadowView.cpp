@@ -8,7 +8,13 @@ namespace reactjuce
 {
     //==============================================================================
     ShadowView::ShadowView(View* _view)
+        : ShadowView(_view, Kind::Generic)
+    {
+    }
+
+    ShadowView::ShadowView(View* _view, Kind kindToUse)
         : shadowViewPimpl(std::make_unique<ShadowViewPimpl>(_view))
+        , kind(kindToUse)
     {
     }
 
@@ -33,6 +39,11 @@ namespace reactjuce
         shadowViewPimpl->removeChild(childView);
     }
 
+    void ShadowView::prepareForReuse()
+    {
+        shadowViewPimpl->prepareForReuse();
+    }
+
     //==============================================================================
     View* ShadowView::getAssociatedView()
     {
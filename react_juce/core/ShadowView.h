@@ -7,7 +7,10 @@ namespace reactjuce
 {
 
     //==============================================================================
-    struct BoundsAnimator : public juce::Timer
+    /** Animates between two bounds, stepping on each frame of the given frame clock,
+     *  or at its own frame rate when there's no clock to follow.
+     */
+    struct BoundsAnimator : private juce::Timer, private FrameClock::Listener
     {
         using StepCallback = std::function<void(juce::Rectangle<float>)>;
 
@@ -26,34 +29,58 @@ namespace reactjuce
         double startTime;
         int frameRate = 45;
         EasingType easingType = EasingType::Linear;
+        FrameClock* frameClock = nullptr;
 
         BoundsAnimator(double durationMs,
                        int frameRateToUse,
                        EasingType et,
                        juce::Rectangle<float> startRect,
                        juce::Rectangle<float> destRect,
-                       StepCallback cb)
+                       StepCallback cb,
+                       FrameClock* clock = nullptr)
             : start(startRect)
             , dest(destRect)
             , callback(std::move (cb))
             , duration(durationMs)
             , frameRate(frameRateToUse)
             , easingType(et)
+            , frameClock(clock)
         {
             startTime = juce::Time::getMillisecondCounterHiRes();
-            startTimerHz(45);
+
+            if (frameClock != nullptr)
+                frameClock->addListener(this);
+            else
+                startTimerHz(frameRate > 0 ? frameRate : 45);
         }
 
         ~BoundsAnimator() override
         {
-            stopTimer();
+            stop();
         }
 
         static constexpr float  lerp (float a, float b, double t)  { return a + (static_cast<float> (t) * (b - a)); }
 
+        void stop()
+        {
+            stopTimer();
+
+            if (frameClock != nullptr)
+                frameClock->removeListener(this);
+        }
+
         void timerCallback() override
         {
-            auto now = juce::Time::getMillisecondCounterHiRes();
+            step(juce::Time::getMillisecondCounterHiRes());
+        }
+
+        void frameCallback (double timestampMs) override
+        {
+            step(timestampMs);
+        }
+
+        void step (double now)
+        {
             double t = std::clamp((now - startTime) / duration, 0.0, 1.0);
 
             // Super helpful cheat sheet: https://gist.github.com/gre/1650294
@@ -77,7 +104,7 @@ namespace reactjuce
             if (t >= 0.9999)
             {
                 callback(dest);
-                stopTimer();
+                stop();
                 return;
             }
 
@@ -105,10 +132,23 @@ namespace reactjuce
         static const inline juce::Identifier frameRateProp      = "frameRate";
         static const inline juce::Identifier layoutAnimatedProp = "layoutAnimated";
 
+        //==============================================================================
+        /** The shadow view classes which the framework has to tell apart. Shadow views
+         *  of any other class are Generic.
+         */
+        enum class Kind : juce::uint8
+        {
+            Generic,
+            Text,
+        };
+
         //==============================================================================
         explicit ShadowView(View* _view);
         virtual ~ShadowView();
 
+        /** Returns the kind of this shadow view, fixed when it was constructed. */
+        Kind getKind() const noexcept { return kind; }
+
         //==============================================================================
         /** Set a property on the shadow view. */
         virtual bool setProperty (const juce::String& name, const juce::var& newValue);
@@ -120,6 +160,12 @@ namespace reactjuce
         /** Removes a child component from the children array. */
         virtual void removeChild (ShadowView* childView);
 
+        /** Restores the default layout style and drops any children and pending
+         *  layout animation, so that a recycling pool can hand the shadow view out
+         *  again. Detaches the layout node from its parent if it still has one.
+         */
+        virtual void prepareForReuse();
+
         //==============================================================================
         /** Returns a pointer to the View instance shadowed by this node. */
         View* getAssociatedView();
@@ -143,6 +189,10 @@ namespace reactjuce
         virtual void flushViewLayoutAnimated(double durationMs, int frameRate, BoundsAnimator::EasingType et);
 
     protected:
+        //==============================================================================
+        /** Constructs a shadow view of the given kind, for the classes listed in Kind. */
+        ShadowView(View* _view, Kind kindToUse);
+
         //==============================================================================
         std::vector<ShadowView*>& getChildren();
 
@@ -154,6 +204,8 @@ namespace reactjuce
         std::unique_ptr<ShadowViewPimpl> shadowViewPimpl;
         friend ShadowViewPimpl;
 
+        Kind kind = Kind::Generic;
+
         //==============================================================================
         JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ShadowView)
     };
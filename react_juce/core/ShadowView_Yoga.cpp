@@ -237,6 +237,23 @@ namespace reactjuce
             }
         }
 
+        void prepareForReuse()
+        {
+            if (auto owner = YGNodeGetOwner(yogaNode))
+                YGNodeRemoveChild(owner, yogaNode);
+
+            YGNodeRemoveAllChildren(yogaNode);
+            children.clear();
+
+            // Copying from a fresh node restores every style default at once, while
+            // leaving alone the context and measure function of text nodes
+            static const std::unique_ptr<YGNode, decltype(&YGNodeFree)> defaultStyleNode (YGNodeNew(), &YGNodeFree);
+            YGNodeCopyStyle(yogaNode, defaultStyleNode.get());
+
+            props.clear();
+            animator.reset();
+        }
+
         //==============================================================================
         View* getAssociatedView() { return view; }
 
@@ -308,7 +325,8 @@ namespace reactjuce
                         v->setFloatBounds(stepBounds);
                         v->setBounds(stepBounds.toNearestInt());
                     }
-                }
+                },
+                view->getFrameClock()
             );
 
             for (auto& child : children)
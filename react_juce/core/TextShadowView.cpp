@@ -10,7 +10,7 @@ namespace reactjuce
 
     //==============================================================================
     TextShadowView::TextShadowView(View* _view)
-        : ShadowView(_view)
+        : ShadowView(_view, Kind::Text)
     {
         textShadowViewPimpl = std::make_unique<TextShadowViewPimpl>(*this);
     }
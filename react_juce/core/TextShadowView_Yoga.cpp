@@ -16,9 +16,11 @@ namespace reactjuce
             juce::ignoreUnused(heightMode);
 
             auto context = reinterpret_cast<TextShadowView*>(YGNodeGetContext(node));
-            auto view = dynamic_cast<TextView*>(context->getAssociatedView());
+            auto* associatedView = context->getAssociatedView();
 
-            jassert (view != nullptr);
+            // A TextShadowView may only shadow a TextView
+            jassert (associatedView != nullptr && associatedView->getKind() == View::Kind::Text);
+            auto view = static_cast<TextView*>(associatedView);
 
             // TODO: This is a bit of an oversimplification. We have a YGMeasureMode which
             // is one of three things, "undefined", "exact", or "at-most." Here we're kind of
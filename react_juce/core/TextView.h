@@ -35,7 +35,7 @@ namespace reactjuce
         static const inline juce::Identifier wordWrapProp      = "word-wrap";
 
         //==============================================================================
-        TextView() = default;
+        TextView() : View(Kind::Text) {}
 
         //==============================================================================
         /** Assembles a Font from properties. */
@@ -73,9 +73,9 @@ namespace reactjuce
             // element to map to a TextView and any nested raw text nodes or <Text> elements
             // map to a juce::AttributedString and carry their own properties. This allows
             // bolding single words inline, for example, and setting line-height, etc.
-            for (auto& c : getChildren())
-                if (RawTextView* v = dynamic_cast<RawTextView*>(c))
-                    text += v->getText();
+            for (auto* v : getChildViews())
+                if (v->getKind() == Kind::RawText)
+                    text += static_cast<RawTextView*>(v)->getText();
 
             juce::AttributedString as (text);
             juce::TextLayout tl;
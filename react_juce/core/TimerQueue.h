@@ -0,0 +1,251 @@
+/*
+  ==============================================================================
+
+    TimerQueue.h
+    Created: 16 Oct 2026 2:40:00pm
+
+  ==============================================================================
+*/
+
+#pragma once
+
+
+namespace reactjuce
+{
+
+    namespace detail
+    {
+        //==============================================================================
+        /** The script each engine evaluates on reset to install its timer globals.
+         *
+         *  It evaluates to a function taking the global object and the native functions
+         *  which schedule and cancel a timer by id. That function installs setTimeout,
+         *  setInterval, clearTimeout and clearInterval, keeping the callbacks in a table
+         *  of its own, and returns the trampoline through which the engine runs the timers
+         *  due on each tick. The trampoline takes the array of due ids, so that every
+         *  expired timer runs within a single call into the engine.
+         *
+         *  A callback which throws doesn't stop the others due with it; the first
+         *  error is rethrown once they have all run.
+         */
+        static const char* const timerGlobalsScript = R"js(
+            (function (global, scheduleTimer, cancelTimer) {
+                var timers = {};
+
+                function makeSetTimer(name, repeats) {
+                    return function (callback, delay) {
+                        if (typeof callback !== 'function' || typeof delay !== 'number')
+                            throw new TypeError(name + ' requires a callback and time in milliseconds');
+
+                        var id = scheduleTimer(delay, repeats);
+                        timers[id] = { callback: callback, args: Array.prototype.slice.call(arguments, 2), repeats: repeats };
+
+                        return id;
+                    };
+                }
+
+                function makeClearTimer(name) {
+                    return function (id) {
+                        if (typeof id !== 'number')
+                            throw new TypeError(name + ' requires an integer ID of the timer to clear');
+
+                        delete timers[id];
+                        cancelTimer(id);
+                    };
+                }
+
+                global.setTimeout    = makeSetTimer('setTimeout', false);
+                global.setInterval   = makeSetTimer('setInterval', true);
+                global.clearTimeout  = makeClearTimer('clearTimeout');
+                global.clearInterval = makeClearTimer('clearInterval');
+
+                return function (ids) {
+                    var failed = false, error;
+
+                    for (var i = 0; i < ids.length; ++i) {
+                        var timer = timers[ids[i]];
+
+                        // Cleared by one of the callbacks before it
+                        if (timer === undefined)
+                            continue;
+
+                        if (!timer.repeats)
+                            delete timers[ids[i]];
+
+                        try {
+                            timer.callback.apply(undefined, timer.args);
+                        } catch (e) {
+                            if (!failed) {
+                                failed = true;
+                                error = e;
+                            }
+                        }
+                    }
+
+                    if (failed)
+                        throw error;
+                };
+            })
+        )js";
+
+        //==============================================================================
+        /** The schedule of the pending timeouts and intervals of a single engine, kept
+         *  in a min-heap ordered by due time so that the engine needs only one native
+         *  timer, set for whichever is due next. The callbacks themselves live on the
+         *  JavaScript side, keyed by timer id.
+         *
+         *  Clearing a timer leaves its heap entry behind, to be skipped when it reaches
+         *  the top; the heap is rebuilt once such stale entries outnumber the live ones.
+         *  Timer ids are scoped to the queue and never reused by it.
+         */
+        class TimerQueue
+        {
+        public:
+            //==============================================================================
+            /** Adds a timer due the given number of milliseconds after `now`, returning
+             *  its id.
+             */
+            int add (double delayMs, bool repeats, double now)
+            {
+                const int id = nextId++;
+                const double intervalMs = juce::jmax(0.0, delayMs);
+
+                timers.emplace(id, PendingTimer { intervalMs, repeats, 0 });
+                schedule(id, now + intervalMs);
+
+                return id;
+            }
+
+            /** Removes the timer with the given id, if it's still pending. */
+            void remove (int id)
+            {
+                timers.erase(id);
+                compactIfMostlyStale();
+            }
+
+            void clear()
+            {
+                timers.clear();
+                heap.clear();
+            }
+
+            /** Returns the time at which the next timer is due, or a negative number if
+             *  there are none.
+             */
+            double getNextDueTime()
+            {
+                discardStaleEntries();
+                return heap.empty() ? -1.0 : heap.front().dueTime;
+            }
+
+            //==============================================================================
+            /** Returns the ids of every timer due at or before `now`, in the order they
+             *  fell due.
+             *
+             *  Timeouts leave the queue, and intervals are rescheduled before they run
+             *  so that they may clear themselves. Timers added while the returned ones
+             *  run wait for the next call.
+             */
+            std::vector<int> takeExpired (double now)
+            {
+                std::vector<int> expired;
+
+                while (!heap.empty() && heap.front().dueTime <= now)
+                {
+                    const auto entry = popEntry();
+
+                    if (isLive(entry))
+                        expired.push_back(entry.id);
+                }
+
+                for (const int id : expired)
+                {
+                    auto it = timers.find(id);
+
+                    if (it->second.repeats)
+                        schedule(id, now + it->second.intervalMs);
+                    else
+                        timers.erase(it);
+                }
+
+                return expired;
+            }
+
+        private:
+            //==============================================================================
+            struct PendingTimer
+            {
+                double intervalMs;
+                bool repeats;
+                juce::uint64 sequence;
+            };
+
+            struct HeapEntry
+            {
+                double dueTime;
+                juce::uint64 sequence;
+                int id;
+
+                // Orders the heap with the earliest due time on top, falling back to the
+                // order of scheduling between timers due at the same time
+                bool operator< (const HeapEntry& other) const
+                {
+                    if (dueTime != other.dueTime)
+                        return dueTime > other.dueTime;
+
+                    return sequence > other.sequence;
+                }
+            };
+
+            //==============================================================================
+            void schedule (int id, double dueTime)
+            {
+                const auto sequence = nextSequence++;
+
+                timers.at(id).sequence = sequence;
+                heap.push_back({ dueTime, sequence, id });
+                std::push_heap(heap.begin(), heap.end());
+            }
+
+            HeapEntry popEntry()
+            {
+                std::pop_heap(heap.begin(), heap.end());
+                const auto entry = heap.back();
+                heap.pop_back();
+
+                return entry;
+            }
+
+            bool isLive (const HeapEntry& entry) const
+            {
+                const auto it = timers.find(entry.id);
+                return it != timers.end() && it->second.sequence == entry.sequence;
+            }
+
+            void discardStaleEntries()
+            {
+                while (!heap.empty() && !isLive(heap.front()))
+                    popEntry();
+            }
+
+            void compactIfMostlyStale()
+            {
+                if (heap.size() < 64 || heap.size() < 2 * timers.size())
+                    return;
+
+                heap.erase(std::remove_if(heap.begin(), heap.end(), [this](const HeapEntry& e) { return !isLive(e); }),
+                           heap.end());
+
+                std::make_heap(heap.begin(), heap.end());
+            }
+
+            //==============================================================================
+            std::unordered_map<int, PendingTimer> timers;
+            std::vector<HeapEntry> heap;
+
+            int nextId = 1;
+            juce::uint64 nextSequence = 0;
+        };
+    }
+
+}
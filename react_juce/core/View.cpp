@@ -8,6 +8,7 @@
 */
 
 #include "View.h"
+#include "ReactApplicationRoot.h"
 #include "Utils.h"
 
 #include <climits>
@@ -25,6 +26,8 @@ namespace reactjuce
 
             juce::Component *componentUnderMouse = topParent->getComponentAt(topRelativeEvent.x, topRelativeEvent.y);
 
+            // The component under the mouse may be anything at all, so this is the one
+            // place a dynamic_cast is needed to tell whether it's a View.
             if (auto v = dynamic_cast<View*>(componentUnderMouse))
                 return v->getViewId();
 
@@ -73,9 +76,32 @@ namespace reactjuce
     }
 
     //==============================================================================
+    View::View()
+        : View(Kind::Generic)
+    {
+    }
+
+    View::View(Kind kind)
+        : _kind(kind)
+    {
+    }
+
+    View::~View()
+    {
+        if (subscribedFrameClock != nullptr)
+            subscribedFrameClock->removeListener(this);
+
+        // Clearing the view table destroys views in no particular order
+        if (_parentView != nullptr)
+            _parentView->unlinkChildView(this);
+
+        for (auto* child : _childViews)
+            child->_parentView = nullptr;
+    }
+
     ViewId View::getViewId() const
     {
-        return juce::DefaultHashFunctions::generateHash(_viewId, INT_MAX);
+        return _viewId;
     }
 
     juce::Identifier View::getRefId() const
@@ -110,12 +136,54 @@ namespace reactjuce
             _refId = juce::Identifier(value.toString());
     }
 
+    void View::prepareForReuse()
+    {
+        jassert(_parentView == nullptr && _childViews.empty());
+
+        props.clear();
+        cachedFloatBounds = {};
+        _refId = {};
+
+        setWantsFrameCallbacks(false);
+        setInterceptsMouseClicks(true, true);
+        setWantsKeyboardFocus(false);
+        setAlpha(1.0f);
+        setTransform({});
+        setBounds({});
+    }
+
     void View::addChild (View* childView, int index)
     {
         // Add the child view to our component heirarchy.
         addAndMakeVisible(childView, index);
     }
 
+    void View::linkChildView (View* childView, int index)
+    {
+        // Mirrors juce::Component::addChildComponent, which leaves an existing child
+        // where it is and takes a child of another component away from it
+        if (childView->_parentView == this)
+            return;
+
+        if (childView->_parentView != nullptr)
+            childView->_parentView->unlinkChildView(childView);
+
+        childView->_parentView = this;
+
+        if (juce::isPositiveAndBelow(index, static_cast<int>(_childViews.size())))
+            _childViews.insert(_childViews.begin() + index, childView);
+        else
+            _childViews.push_back(childView);
+    }
+
+    void View::unlinkChildView (View* childView)
+    {
+        jassert(childView->_parentView == this);
+        childView->_parentView = nullptr;
+
+        _childViews.erase(std::remove(_childViews.begin(), _childViews.end(), childView), _childViews.end());
+    }
+
     void View::setFloatBounds(juce::Rectangle<float> bounds)
     {
         cachedFloatBounds = bounds;
@@ -306,4 +374,45 @@ namespace reactjuce
 
         throw std::logic_error("Caller attempted to invoke a non-existent View method");
     }
+
+    //==============================================================================
+    FrameClock* View::getFrameClock()
+    {
+        if (auto* appRoot = findParentComponentOfClass<ReactApplicationRoot>())
+            return &appRoot->getFrameClock();
+
+        return nullptr;
+    }
+
+    void View::parentHierarchyChanged()
+    {
+        updateFrameClockSubscription();
+    }
+
+    void View::setWantsFrameCallbacks (bool shouldReceiveCallbacks)
+    {
+        wantsFrameCallbacks = shouldReceiveCallbacks;
+        updateFrameClockSubscription();
+    }
+
+    void View::frameCallback (double timestampMs)
+    {
+        juce::ignoreUnused(timestampMs);
+    }
+
+    void View::updateFrameClockSubscription()
+    {
+        auto* clock = wantsFrameCallbacks ? getFrameClock() : nullptr;
+
+        if (clock == subscribedFrameClock)
+            return;
+
+        if (subscribedFrameClock != nullptr)
+            subscribedFrameClock->removeListener(this);
+
+        subscribedFrameClock = clock;
+
+        if (subscribedFrameClock != nullptr)
+            subscribedFrameClock->addListener(this);
+    }
 }
@@ -11,22 +11,25 @@
 
 #include <map>
 
+#include "FrameClock.h"
+
 
 namespace reactjuce
 {
 
-    // Internally we use a juce::Uuid for uniquely identifying views, but we
-    // need that same identifier to make a transit through JavaScript land
-    // and still match afterwards. So we map our Uuids into a signed 32-bit integer
-    // type and leave Duktape to perform the appropriate cast through JavaScript's
-    // double-width "Number" type.
+    // We identify views by a non-negative signed 32-bit integer assigned by the
+    // ViewManager, combining the index of the view's slot in its table with the
+    // generation of that slot. The identifier needs to make a transit through
+    // JavaScript land and still match afterwards, which it does intact through
+    // JavaScript's double-width "Number" type. Negative ids are left free for the
+    // placeholders of views created within a mutation batch.
     using ViewId = juce::int32;
 
     //==============================================================================
     /** The View class is the core component abstraction for React-JUCE's declarative
         flex-based component composition.
      */
-    class View : public juce::Component
+    class View : public juce::Component, private FrameClock::Listener
     {
     public:
         //==============================================================================
@@ -44,13 +47,35 @@ namespace reactjuce
         static const inline juce::Identifier borderWidthProp          = "border-width";
 
         //==============================================================================
-        View() = default;
-        ~View() override = default;
+        /** The view classes which the framework has to tell apart, such as when
+         *  laying out text. Views of any other class are Generic.
+         */
+        enum class Kind : juce::uint8
+        {
+            Generic,
+            Text,
+            RawText,
+        };
+
+        //==============================================================================
+        View();
+        ~View() override;
+
+        //==============================================================================
+        /** Returns the kind of this view, fixed when it was constructed. */
+        Kind getKind() const noexcept { return _kind; }
 
         //==============================================================================
-        /** Returns this view's identifier. */
+        /** Returns this view's identifier, or -1 if it hasn't been added to a
+         *  ViewManager.
+         */
         ViewId getViewId() const;
 
+        /** Returns the frame clock of the ReactApplicationRoot this view belongs to,
+         *  or nullptr while it isn't attached to one.
+         */
+        virtual FrameClock* getFrameClock();
+
         /** Returns this view's reference identifier, optionally set via React props. */
         juce::Identifier getRefId() const;
 
@@ -60,6 +85,25 @@ namespace reactjuce
         /** Adds a child component behind the existing children. */
         virtual void addChild (View* childView, int index = -1);
 
+        /** Returns the view this one was inserted into by its ViewManager, or nullptr. */
+        View* getParentView() const noexcept { return _parentView; }
+
+        /** Returns the views inserted into this one by its ViewManager, in order.
+         *
+         *  Unlike the component's children these are all Views, including any that a
+         *  subclass mounts further down its own hierarchy, like a ScrollView's content.
+         */
+        const std::vector<View*>& getChildViews() const noexcept { return _childViews; }
+
+        /** Restores the view to its default state, so that a recycling pool can hand
+         *  it out again as though newly created. Called once the view has been removed
+         *  from its parent and its View children have been taken out of it.
+         *
+         *  Subclasses with state beyond their props must override this, calling the
+         *  base implementation, before their view type is given a recycling pool.
+         */
+        virtual void prepareForReuse();
+
         /** Updates the cached float layout bounds from the shadow tree. */
         void setFloatBounds (juce::Rectangle<float> bounds);
 
@@ -103,7 +147,17 @@ namespace reactjuce
         /** Invokes an "exported" native method on the View instance */
         juce::var invokeMethod(const juce::String &method, const juce::var::NativeFunctionArgs &args);
 
+        //==============================================================================
+        /** Follows the view onto the frame clock of whichever root it now belongs to.
+         *  Subclasses overriding this must call the base implementation.
+         */
+        void parentHierarchyChanged() override;
+
     protected:
+        //==============================================================================
+        /** Constructs a view of the given kind, for the view classes listed in Kind. */
+        explicit View (Kind kind);
+
         //==============================================================================
         /** Exports/Registers a method on this View instance so it may be called
          *  directly from React. This is here to support calling ViewInstance functions
@@ -111,17 +165,45 @@ namespace reactjuce
          * */
         void exportMethod(const juce::String &method, juce::var::NativeFunction fn);
 
+        //==============================================================================
+        /** Starts or stops calls to `frameCallback` on each tick of the root's frame
+         *  clock. A view which isn't attached to a root yet starts receiving them once
+         *  it is.
+         */
+        void setWantsFrameCallbacks (bool shouldReceiveCallbacks);
+
+        /** Called on each frame while the view wants frame callbacks. */
+        void frameCallback (double timestampMs) override;
+
         //==============================================================================
         juce::NamedValueSet props;
         juce::Rectangle<float> cachedFloatBounds;
 
     private:
         //==============================================================================
-        juce::Uuid _viewId;
+        friend class ViewManager;
+
+        ViewId _viewId = -1;
         juce::Identifier _refId;
+        Kind _kind = Kind::Generic;
+
+        View* _parentView = nullptr;
+        std::vector<View*> _childViews;
 
         std::unordered_map<juce::String, juce::var::NativeFunction> nativeMethods;
 
+        bool wantsFrameCallbacks = false;
+        FrameClock* subscribedFrameClock = nullptr;
+
+        void updateFrameClockSubscription();
+
+        /** Records the child view as inserted at the given index, or at the end if the
+         *  index is out of range, as `addChild` does with the child component. These
+         *  links let views find each other without asking each component what it is.
+         */
+        void linkChildView (View* childView, int index);
+        void unlinkChildView (View* childView);
+
         //==============================================================================
         JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (View)
     };
@@ -37,10 +37,14 @@ namespace reactjuce
 
     }
 
-    ViewManager::ViewManager(View* rootView)
-        : rootId(rootView->getViewId())
+    ViewManager::ViewManager(View* root)
+        : rootId(viewTable.reserveId())
+        , rootView(root)
     {
-        shadowViewTable[rootId] = std::make_unique<ShadowView>(rootView);
+        // The root view belongs to whoever created it, so its slot only holds
+        // the shadow view
+        rootView->_viewId = rootId;
+        viewTable.insert(rootId, nullptr, std::make_unique<ShadowView>(rootView));
 
         // Register the default view types
         registerViewType("View", GenericViewFactory<View, ShadowView>());
@@ -60,27 +64,134 @@ namespace reactjuce
         viewFactories[typeId] = f;
     }
 
+    void ViewManager::setRecyclingPoolCapacity(const juce::String& typeId, size_t capacity)
+    {
+        // We can't pool views of a type that hasn't been registered.
+        jassert (viewFactories.find(typeId) != viewFactories.end());
+
+        auto& pool = viewPools[typeId];
+
+        if (pool == nullptr)
+            pool = std::make_unique<detail::ViewPool>();
+
+        pool->setCapacity(capacity);
+    }
+
+    void ViewManager::setTeardownSliceBudget(double budgetMs)
+    {
+        teardownQueue.setSliceBudget(budgetMs);
+    }
+
+    ViewManager::TeardownStats ViewManager::getTeardownStats() const
+    {
+        return teardownQueue.getStats();
+    }
+
+    ViewManager::RecyclingPoolStats ViewManager::getRecyclingPoolStats(const juce::String& typeId) const
+    {
+        RecyclingPoolStats stats;
+
+        if (auto it = viewPools.find(typeId); it != viewPools.end())
+        {
+            stats.capacity  = it->second->getCapacity();
+            stats.numParked = it->second->getNumParked();
+            stats.numHits   = it->second->getNumHits();
+            stats.numMisses = it->second->getNumMisses();
+        }
+
+        return stats;
+    }
+
+    ViewId ViewManager::reserveViewId()
+    {
+        return viewTable.reserveId();
+    }
+
     ViewId ViewManager::createViewInstance(const juce::String& viewType)
+    {
+        return addViewOfType(viewType, -1);
+    }
+
+    ViewId ViewManager::createTextViewInstance(const juce::String& value)
+    {
+        return addViewInstance(std::make_unique<RawTextView>(value), nullptr, -1);
+    }
+
+    ViewId ViewManager::addViewInstance (std::unique_ptr<View> view, std::unique_ptr<ShadowView> shadowView, ViewId id)
+    {
+        if (id < 0)
+            id = viewTable.reserveId();
+
+        view->_viewId = id;
+        viewTable.insert(id, std::move(view), std::move(shadowView));
+
+        return id;
+    }
+
+    ViewId ViewManager::addViewOfType (const juce::String& viewType, ViewId id)
     {
         // We can't create a view instance of a type that hasn't been registered.
         jassert (viewFactories.find(viewType) != viewFactories.end());
 
-        auto [view, shadowView] = viewFactories[viewType]();
-        ViewId vid = view->getViewId();
+        detail::ViewPool* pool = nullptr;
+
+        if (auto it = viewPools.find(viewType); it != viewPools.end() && it->second->getCapacity() > 0)
+            pool = it->second.get();
+
+        ViewPair pair;
+
+        if (pool != nullptr)
+            pair = pool->acquire();
 
-        viewTable[vid] = std::move(view);
-        shadowViewTable[vid] = std::move(shadowView);
+        if (pair.first == nullptr)
+            pair = viewFactories[viewType]();
 
-        return vid;
+        id = addViewInstance(std::move(pair.first), std::move(pair.second), id);
+        viewTable.find(id)->pool = pool;
+
+        return id;
     }
 
-    ViewId ViewManager::createTextViewInstance(const juce::String& value)
+    void ViewManager::releaseRemovedView (ViewId viewId)
     {
-        std::unique_ptr<View> view = std::make_unique<RawTextView>(value);
-        ViewId id = view->getViewId();
+        auto* slot = viewTable.find(viewId);
 
-        viewTable[id] = std::move(view);
-        return id;
+        if (slot == nullptr)
+            return;
+
+        if (auto* view = slot->view.get())
+        {
+            unindexRefId(view);
+
+            if (auto* parentView = view->getParentView())
+                parentView->unlinkChildView(view);
+
+            // Whether parked or queued, the view leaves its parent now. Children come
+            // first, so by the time a parent is parked none of them remain inside it
+            // to be painted or sent events should the parent be handed out again
+            // while they wait in the teardown queue.
+            if (auto* parent = view->getParentComponent())
+                parent->removeChildComponent(view);
+        }
+
+        if (slot->pool != nullptr && slot->pool->hasRoom())
+        {
+            auto& view = *slot->view;
+
+            view._viewId = -1;
+            view.prepareForReuse();
+
+            if (slot->shadowView != nullptr)
+                slot->shadowView->prepareForReuse();
+
+            slot->pool->park({ std::move(slot->view), std::move(slot->shadowView) });
+        }
+        else
+        {
+            teardownQueue.push({ std::move(slot->view), std::move(slot->shadowView) });
+        }
+
+        viewTable.erase(viewId);
     }
 
     void ViewManager::setViewProperty(ViewId viewId, const juce::String& name, const juce::var& value)
@@ -90,7 +201,19 @@ namespace reactjuce
         // ShadowView::setProperty returns true when a layout prop
         // has been set.  Otherwise set on the view and repaint
         if(!shadow->setProperty(name, value)) {
-          view->setProperty(name, value);
+          if (View::refIdProp == name)
+          {
+              unindexRefId(view);
+              view->setProperty(name, value);
+
+              if (view->getRefId().isValid())
+                  viewsByRefId[view->getRefId().getCharPointer().getAddress()].push_back(view);
+          }
+          else
+          {
+              view->setProperty(name, value);
+          }
+
           view->repaint();
         }
     }
@@ -99,20 +222,24 @@ namespace reactjuce
     {
         View* view = getViewHandle(viewId).first;
 
-        if (auto* rawTextView = dynamic_cast<RawTextView*>(view))
+        if (view != nullptr && view->getKind() == View::Kind::RawText)
         {
+            auto* rawTextView = static_cast<RawTextView*>(view);
+
             // Update text
             rawTextView->setText(value);
 
-            if (auto* parent = dynamic_cast<TextView*>(rawTextView->getParentComponent()))
+            auto* parent = rawTextView->getParentView();
+
+            if (parent != nullptr && parent->getKind() == View::Kind::Text)
             {
                 // If we have a parent already, find the parent's shadow node and
                 // mark it dirty, then we'll issue a new layout call
                 ShadowView* parentShadowView = getViewHandle(parent->getViewId()).second;
 
-                if (auto* textShadowView = dynamic_cast<TextShadowView*>(parentShadowView))
+                if (parentShadowView != nullptr && parentShadowView->getKind() == ShadowView::Kind::Text)
                 {
-                    textShadowView->markDirty();
+                    static_cast<TextShadowView*>(parentShadowView)->markDirty();
                 }
 
                 // Then we need to paint, but the RawTextView has no idea how to paint its text,
@@ -130,22 +257,25 @@ namespace reactjuce
         const auto& [parentView, parentShadowView] = getViewHandle(parentId);
         const auto& [childView, childShadowView] = getViewHandle(childId);
 
-        if (dynamic_cast<TextView*>(parentView))
+        if (parentView->getKind() == View::Kind::Text)
         {
             // If we're trying to append a child to a text view, it will be raw text
             // with no accompanying shadow view, and we'll need to mark the parent
             // TextShadowView dirty before the subsequent layout pass.
-            jassert (dynamic_cast<RawTextView*>(childView) != nullptr);
+            jassert (childView->getKind() == View::Kind::RawText);
             jassert (childShadowView == nullptr);
+            jassert (parentShadowView->getKind() == ShadowView::Kind::Text);
 
             parentView->addChild(childView, index);
-            dynamic_cast<TextShadowView*>(parentShadowView)->markDirty();
+            static_cast<TextShadowView*>(parentShadowView)->markDirty();
         }
         else
         {
             parentView->addChild(childView, index);
             parentShadowView->addChild(childShadowView, index);
         }
+
+        parentView->linkChildView(childView, index);
     }
 
     void ViewManager::removeChild(ViewId parentId, ViewId childId)
@@ -160,52 +290,179 @@ namespace reactjuce
         // that method virtual so that, e.g., the scroll view can override to
         // remove the child from its viewport
         parentView->removeChildComponent(childView);
+        parentView->unlinkChildView(childView);
+
+        // We might be dealing with a text view, in which case we expect a null
+        // shadow view.
+        if (parentShadowView && childShadowView)
+            parentShadowView->removeChild(childShadowView);
 
         // Here we have to clear the view table of all children of this view.
         // React may clear a whole subtree from the interface by removing a
         // single component at the root of the tree. Because the view table
-        // is a flat map of viewId to View, if we only remove that root view
-        // from the table we leave all of its children dangling, which confuses
-        // subsequent functionality like `getViewHandle` or `getViewByRefId`
+        // is flat, if we only remove that root view from the table we leave
+        // all of its children dangling, which confuses subsequent functionality
+        // like `getViewHandle` or `getViewByRefId`. The ids come children first,
+        // so each view is parked or destroyed after its descendants. Destruction
+        // itself is deferred, so that a large subtree doesn't stall the commit.
         std::vector<ViewId> childIds;
         enumerateChildViewIds(childIds, childView);
 
         for (auto& id : childIds)
-            viewTable.erase(id);
+            releaseRemovedView(id);
+    }
 
-        // We might be dealing with a text view, in which case we expect a null
-        // shadow view.
-        if (parentShadowView && childShadowView)
+    juce::var ViewManager::applyMutations(const juce::var& mutations, const std::vector<ViewId>& reservedIds)
+    {
+        // If you hit this, the mutation buffer didn't come from the Backend.ts
+        // mutation queue.
+        jassert(mutations.isArray());
+
+        std::vector<ViewId> createdIds;
+
+        if (const auto* ops = mutations.getArray())
         {
-            parentShadowView->removeChild(childShadowView);
+            const int numOps = ops->size();
+            int pos = 0;
 
-            // Then here, since we now know we have a child shadow view,
-            // we try also to remove its children from the shadowViewTable to
-            // prevent dangling children like in the viewTable above.
-            for (auto& id : childIds)
-                shadowViewTable.erase(id);
+            auto next = [&]() -> const juce::var&
+            {
+                if (pos >= numOps)
+                    throw std::invalid_argument("Truncated mutation buffer.");
+
+                return ops->getReference(pos++);
+            };
+
+            auto nextViewId = [&]() -> ViewId
+            {
+                const ViewId id = next();
+
+                if (id >= 0)
+                    return id;
+
+                const auto createdIndex = static_cast<size_t>(-(id + 1));
+
+                if (createdIndex >= createdIds.size())
+                    throw std::invalid_argument("Mutation buffer refers to a view that has not been created.");
+
+                return createdIds[createdIndex];
+            };
+
+            auto nextReservedId = [&]() -> ViewId
+            {
+                if (reservedIds.empty())
+                    return -1;
+
+                if (createdIds.size() >= reservedIds.size())
+                    throw std::invalid_argument("Mutation buffer creates more views than were reserved.");
+
+                return reservedIds[createdIds.size()];
+            };
+
+            while (pos < numOps)
+            {
+                switch (static_cast<MutationType>(static_cast<int>(next())))
+                {
+                    case MutationType::CreateView:
+                    {
+                        const juce::String viewType = next().toString();
+                        createdIds.push_back(addViewOfType(viewType, nextReservedId()));
+                        break;
+                    }
+
+                    case MutationType::CreateTextView:
+                        createdIds.push_back(addViewInstance(std::make_unique<RawTextView>(next().toString()), nullptr, nextReservedId()));
+                        break;
+
+                    case MutationType::InsertChild:
+                    {
+                        const ViewId parentId = nextViewId();
+                        const ViewId childId  = nextViewId();
+                        insertChild(parentId, childId, next());
+                        break;
+                    }
+
+                    case MutationType::RemoveChild:
+                    {
+                        const ViewId parentId = nextViewId();
+                        removeChild(parentId, nextViewId());
+                        break;
+                    }
+
+                    case MutationType::SetProperty:
+                    {
+                        const ViewId viewId = nextViewId();
+                        const juce::String name = next().toString();
+                        setViewProperty(viewId, name, next());
+                        break;
+                    }
+
+                    case MutationType::SetRawTextValue:
+                    {
+                        const ViewId viewId = nextViewId();
+                        setRawTextValue(viewId, next().toString());
+                        break;
+                    }
+
+                    default:
+                        throw std::invalid_argument("Unknown mutation type in mutation buffer.");
+                }
+            }
         }
+
+        juce::Array<juce::var> result;
+        result.ensureStorageAllocated(static_cast<int>(createdIds.size()));
+
+        for (auto id : createdIds)
+            result.add(id);
+
+        return result;
     }
 
-    void ViewManager::enumerateChildViewIds (std::vector<ViewId>& ids, View* v)
+    int ViewManager::countCreatedViews(const juce::var& mutations)
     {
-        for (auto* child : v->getChildren())
+        int numCreated = 0;
+
+        if (const auto* ops = mutations.getArray())
         {
-            // Some view elements may mount a plain juce::Component, such as the
-            // ScrollView mounting a juce::Viewport which is a juce::Component but
-            // not a juce::View. Such elements aren't in our table and can be skipped
-            if (auto* childView = dynamic_cast<View*>(child))
+            for (int pos = 0; pos < ops->size();)
             {
-                enumerateChildViewIds(ids, childView);
+                int numArgs = 0;
+
+                switch (static_cast<MutationType>(static_cast<int>(ops->getReference(pos))))
+                {
+                    case MutationType::CreateView:
+                    case MutationType::CreateTextView:  numArgs = 1; ++numCreated; break;
+                    case MutationType::InsertChild:     numArgs = 3; break;
+                    case MutationType::RemoveChild:     numArgs = 2; break;
+                    case MutationType::SetProperty:     numArgs = 3; break;
+                    case MutationType::SetRawTextValue: numArgs = 2; break;
+
+                    default:
+                        throw std::invalid_argument("Unknown mutation type in mutation buffer.");
+                }
+
+                pos += 1 + numArgs;
             }
         }
 
+        return numCreated;
+    }
+
+    void ViewManager::enumerateChildViewIds (std::vector<ViewId>& ids, View* v)
+    {
+        // Walking the child views rather than the child components skips the plain
+        // juce::Components some views mount, such as the ScrollView's juce::Viewport,
+        // while still reaching the views mounted inside them
+        for (auto* childView : v->getChildViews())
+            enumerateChildViewIds(ids, childView);
+
         ids.push_back(v->getViewId());
     }
 
     void ViewManager::performRootShadowTreeLayout()
     {
-        ShadowView* root = shadowViewTable[rootId].get();
+        ShadowView* root = getViewHandle(rootId).second;
         jassert(root);
 
         juce::Rectangle<float> rootBounds = root->getAssociatedView()->getLocalBounds().toFloat();
@@ -218,13 +475,12 @@ namespace reactjuce
 
     void ViewManager::clearViewTables()
     {
-        auto nh = shadowViewTable.extract(rootId);
-
-        viewTable.clear();
-        shadowViewTable.clear();
+        viewTable.clearAllExcept(rootId);
+        viewsByRefId.clear();
+        teardownQueue.flush();
 
         // Make a new root shadow view to reinitialize the view table
-        shadowViewTable[rootId] = std::make_unique<ShadowView>(nh.mapped()->getAssociatedView());
+        viewTable.find(rootId)->shadowView = std::make_unique<ShadowView>(rootView);
     }
 
     juce::var ViewManager::invokeViewMethod(ViewId viewId, const juce::String &method, const juce::var::NativeFunctionArgs &args)
@@ -237,11 +493,8 @@ namespace reactjuce
 
     std::pair<View*, ShadowView*> ViewManager::getViewHandle (ViewId viewId)
     {
-        if (viewId == rootId)
-            return {shadowViewTable[viewId]->getAssociatedView(), shadowViewTable[viewId].get()};
-
-        if (viewTable.find(viewId) != viewTable.end())
-            return {viewTable[viewId].get(), shadowViewTable[viewId].get()};
+        if (auto* slot = viewTable.find(viewId))
+            return {viewId == rootId ? rootView : slot->view.get(), slot->shadowView.get()};
 
         // If we land here, you asked for a view that we don't have.
         jassertfalse;
@@ -251,24 +504,39 @@ namespace reactjuce
     View* ViewManager::getViewByRefId (const juce::Identifier& refId)
     {
         if (refId == getRootViewRefId())
-            return shadowViewTable[rootId]->getAssociatedView();
+            return rootView;
 
-        for (auto& pair : viewTable)
-        {
-            auto* view = pair.second.get();
-
-            if (refId == view->getRefId())
-                return view;
-        }
+        if (auto it = viewsByRefId.find(refId.getCharPointer().getAddress()); it != viewsByRefId.end())
+            return it->second.back();
 
         return nullptr;
     }
 
+    void ViewManager::unindexRefId (View* view)
+    {
+        const auto refId = view->getRefId();
+
+        if (!refId.isValid())
+            return;
+
+        auto it = viewsByRefId.find(refId.getCharPointer().getAddress());
+
+        if (it == viewsByRefId.end())
+            return;
+
+        auto& views = it->second;
+        views.erase(std::remove(views.begin(), views.end(), view), views.end());
+
+        // Dropping the entry along with its last view, whose Identifier may have
+        // been the last to keep the key's string alive
+        if (views.empty())
+            viewsByRefId.erase(it);
+    }
+
     juce::Identifier ViewManager::getRootViewRefId()
     {
-       View* root = shadowViewTable[rootId]->getAssociatedView();
-       jassert(root);
+       jassert(rootView);
 
-       return root->getRefId();
+       return rootView->getRefId();
     }
 }
@@ -10,9 +10,13 @@
 #pragma once
 
 #include <map>
+#include <unordered_map>
 
 #include "View.h"
 #include "ShadowView.h"
+#include "ViewPool.h"
+#include "ViewTable.h"
+#include "ViewTeardownQueue.h"
 
 
 namespace reactjuce
@@ -37,6 +41,20 @@ namespace reactjuce
         using ViewPair = std::pair<std::unique_ptr<View>, std::unique_ptr<ShadowView>>;
         using ViewFactory = std::function<ViewPair()>;
 
+        // The opcodes understood by `applyMutations`. Each opcode is followed in
+        // the mutation buffer by a fixed number of arguments, noted alongside.
+        // These values must be kept in sync with the MutationType table in
+        // packages/react-juce/src/lib/Backend.ts.
+        enum class MutationType
+        {
+            CreateView      = 0, // viewType
+            CreateTextView  = 1, // textValue
+            InsertChild     = 2, // parentId, childId, index
+            RemoveChild     = 3, // parentId, childId
+            SetProperty     = 4, // viewId, name, value
+            SetRawTextValue = 5, // viewId, textValue
+        };
+
         //==============================================================================
         explicit ViewManager(View* rootView);
         ~ViewManager() = default;
@@ -44,6 +62,56 @@ namespace reactjuce
         /** Registers a new dynamic view type and its associated factory. */
         void registerViewType(const juce::String& typeId, ViewFactory f);
 
+        /** The state of the recycling pool of a view type. */
+        struct RecyclingPoolStats
+        {
+            size_t capacity = 0;
+            size_t numParked = 0;
+
+            /** The number of views handed out from the pool rather than the factory. */
+            size_t numHits = 0;
+
+            /** The number of views the factory had to create while the pool was enabled. */
+            size_t numMisses = 0;
+        };
+
+        /** Enables recycling of views of a registered type, keeping up to the given
+         *  number of removed views parked to be handed out again in place of new ones
+         *  from the factory. A capacity of zero disables recycling and destroys any
+         *  parked views.
+         *
+         *  Removed views are prepared with `View::prepareForReuse` and
+         *  `ShadowView::prepareForReuse`, so only enable recycling for types whose
+         *  views those restore to their default state. Of the built in types, that's
+         *  "View", "Text" and "ScrollViewContentView".
+         */
+        void setRecyclingPoolCapacity(const juce::String& typeId, size_t capacity);
+
+        /** Returns the state of the recycling pool of a registered type. */
+        RecyclingPoolStats getRecyclingPoolStats(const juce::String& typeId) const;
+
+        /** The state of the queue of removed views awaiting destruction: its current
+         *  and peak depth, the number of views destroyed from it, and the durations
+         *  of the slices in which they were destroyed, in milliseconds.
+         */
+        using TeardownStats = detail::ViewTeardownQueue::Stats;
+
+        /** Sets the longest each slice of deferred view destruction may take, in
+         *  milliseconds. Defaults to 2ms.
+         *
+         *  Views removed by `removeChild` leave the tree and the view table at once,
+         *  but are destroyed later, in slices run whenever the message loop has a gap.
+         */
+        void setTeardownSliceBudget(double budgetMs);
+
+        /** Returns the state of the deferred destruction queue. */
+        TeardownStats getTeardownStats() const;
+
+        /** Reserves an id for a view to be created later, such as by a batch of
+         *  mutations assembled on another thread. Safe to call from any thread.
+         */
+        ViewId reserveViewId();
+
         /** Creates a new view instance and registers it with the view table. */
         ViewId createViewInstance(const juce::String& viewType);
 
@@ -68,6 +136,29 @@ namespace reactjuce
         /** Removes a child View from the given parent View */
         void removeChild (ViewId parentId, ViewId childId);
 
+        /** Applies, in order, a flat buffer of mutations collected by the reconciler
+         *  over a single commit.
+         *
+         *  Views created within the batch haven't been assigned a ViewId by the time
+         *  the buffer is assembled, so later operations in the same batch refer to
+         *  them with negative placeholder ids: -1 for the first view created in the
+         *  batch, -2 for the second, and so on.
+         *
+         *  Ordinarily each created view is assigned a fresh id. When the buffer was
+         *  assembled on another thread, the ids may instead have been handed out up
+         *  front with `reserveViewId`, in which case `reservedIds` gives the id of
+         *  each created view in creation order.
+         *
+         *  @returns an array of the ViewIds of each view created by the batch, in
+         *           creation order.
+         */
+        juce::var applyMutations(const juce::var& mutations, const std::vector<ViewId>& reservedIds = {});
+
+        /** Returns the number of views the given mutation buffer creates, without
+         *  applying it. Safe to call from any thread.
+         */
+        static int countCreatedViews(const juce::var& mutations);
+
         /** Recursively computes the shadow tree layout on the root ShadowView, then traverses the tree
             flushing new layout bounds to the associated view components.
          */
@@ -81,24 +172,56 @@ namespace reactjuce
          **/
         juce::var invokeViewMethod(ViewId viewId, const juce::String &method, const juce::var::NativeFunctionArgs &args);
 
+        /** Returns the view whose `refId` prop has the given value, or nullptr if
+         *  there is none. Should several views share a refId, this returns whichever
+         *  of those still holding it was given it most recently.
+         *
+         *  Views are indexed by refId as the prop is set through `setViewProperty`,
+         *  so the lookup takes constant time however large the tree.
+         */
+        View* getViewByRefId (const juce::Identifier& refId);
+
         //==============================================================================
     private:
+        /** Registers the given views under the given reserved id, or under a fresh
+         *  one when the given id is negative.
+         */
+        ViewId addViewInstance (std::unique_ptr<View> view, std::unique_ptr<ShadowView> shadowView, ViewId id);
+
+        /** Creates a view of a registered type, from its recycling pool if possible,
+         *  and registers it under the given id as with `addViewInstance`.
+         */
+        ViewId addViewOfType (const juce::String& viewType, ViewId id);
+
+        /** Erases a removed view from the view table, parking it in the recycling
+         *  pool of its type if that has room, or else queuing it for destruction.
+         */
+        void releaseRemovedView (ViewId viewId);
+
         void enumerateChildViewIds (std::vector<ViewId>& ids, View* v);
 
         /** Returns a pointer pair to the view associated to the given id. */
         std::pair<View*, ShadowView*> getViewHandle (ViewId viewId);
 
-        /** Walks the view table, returning the first view with a `refId`
-         *  whose value equals the provided id.
-         */
-        View* getViewByRefId (const juce::Identifier& refId);
-
         /** Helper function to return refId of the root view */
         juce::Identifier getRootViewRefId();
 
+        /** Removes the view from the views indexed under its refId, if it has one. */
+        void unindexRefId (View* view);
+
         ViewId                                        rootId;
-        std::map<ViewId, std::unique_ptr<View>>       viewTable;
-        std::map<ViewId, std::unique_ptr<ShadowView>> shadowViewTable;
+        View*                                         rootView;
+        detail::ViewTable                             viewTable;
         std::map<juce::String, ViewFactory>           viewFactories;
+
+        // Keyed by the pooled string of each refId, which the indexed views' own
+        // copies of the Identifier keep alive. A refId is an ordinary prop, so
+        // several views may share one; they're listed in the order they took it.
+        std::unordered_map<const char*, std::vector<View*>> viewsByRefId;
+        detail::ViewTeardownQueue                     teardownQueue;
+
+        // Pools are created on demand and never destroyed, as slots of the view
+        // table refer to them
+        std::map<juce::String, std::unique_ptr<detail::ViewPool>> viewPools;
     };
 }
@@ -0,0 +1,91 @@
+/*
+  ==============================================================================
+
+    ViewPool.h
+    Created: 16 Oct 2026 9:40:00pm
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "View.h"
+#include "ShadowView.h"
+
+
+namespace reactjuce
+{
+
+    namespace detail
+    {
+        //==============================================================================
+        /** Views of a single type, removed from the tree and parked to be handed out
+         *  again in place of new ones from the type's factory.
+         *
+         *  The pool holds at most `capacity` views, destroying whatever is offered
+         *  beyond that. It counts each request it could serve as a hit, and each it
+         *  couldn't as a miss.
+         */
+        class ViewPool
+        {
+        public:
+            using ViewPair = std::pair<std::unique_ptr<View>, std::unique_ptr<ShadowView>>;
+
+            //==============================================================================
+            /** Changes the most views the pool may hold, destroying any above it. */
+            void setCapacity (size_t newCapacity)
+            {
+                capacity = newCapacity;
+
+                if (parked.size() > capacity)
+                    parked.resize(capacity);
+            }
+
+            size_t getCapacity() const   { return capacity; }
+            size_t getNumParked() const  { return parked.size(); }
+            size_t getNumHits() const    { return numHits; }
+            size_t getNumMisses() const  { return numMisses; }
+
+            /** Returns true if the pool would take another pair of views. */
+            bool hasRoom() const
+            {
+                return parked.size() < capacity;
+            }
+
+            //==============================================================================
+            /** Returns a parked pair of views, or a pair of nullptrs if the pool is empty. */
+            ViewPair acquire()
+            {
+                if (parked.empty())
+                {
+                    ++numMisses;
+                    return {};
+                }
+
+                ++numHits;
+
+                auto pair = std::move(parked.back());
+                parked.pop_back();
+
+                return pair;
+            }
+
+            /** Parks a pair of views already prepared for reuse. Must only be called
+             *  while the pool has room.
+             */
+            void park (ViewPair pair)
+            {
+                jassert(hasRoom());
+                parked.push_back(std::move(pair));
+            }
+
+        private:
+            //==============================================================================
+            std::vector<ViewPair> parked;
+            size_t capacity = 0;
+            size_t numHits = 0;
+            size_t numMisses = 0;
+        };
+    }
+
+}
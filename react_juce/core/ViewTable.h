@@ -0,0 +1,185 @@
+/*
+  ==============================================================================
+
+    ViewTable.h
+    Created: 16 Oct 2026 8:50:00pm
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "View.h"
+#include "ShadowView.h"
+#include "ViewPool.h"
+
+
+namespace reactjuce
+{
+
+    namespace detail
+    {
+        //==============================================================================
+        /** The views of a ViewManager, kept in a slot map indexed by ViewId.
+         *
+         *  The low bits of an id index a slot, and the bits above them carry the
+         *  generation of that slot, bumped each time the slot is freed. A lookup is a
+         *  single indexed load and comparison, and an id held on to after its view was
+         *  removed no longer matches once the slot is reused. Each slot keeps a View
+         *  alongside its ShadowView, so the pair is found together.
+         *
+         *  Ids may be reserved from any thread, ahead of the views they identify
+         *  being inserted; everything else happens on the message thread.
+         */
+        class ViewTable
+        {
+        public:
+            //==============================================================================
+            struct Slot
+            {
+                ViewId                      id = -1;
+                std::unique_ptr<View>       view;
+                std::unique_ptr<ShadowView> shadowView;
+
+                /** The recycling pool of the view's type, if it has one. */
+                ViewPool*                   pool = nullptr;
+            };
+
+            static constexpr int          numIndexBits = 20;
+            static constexpr juce::uint32 maxNumSlots = 1u << numIndexBits;
+
+            //==============================================================================
+            /** Returns an id for a view about to be inserted. Safe to call from any thread. */
+            ViewId reserveId()
+            {
+                const juce::SpinLock::ScopedLockType sl (allocationLock);
+
+                if (!freeIndices.empty())
+                {
+                    const auto index = freeIndices.back();
+                    freeIndices.pop_back();
+
+                    return makeId(index, generations[index]);
+                }
+
+                // If you hit this, you have more views alive at once than ids can tell apart
+                jassert(generations.size() < maxNumSlots);
+
+                generations.push_back(0);
+                return makeId(static_cast<juce::uint32>(generations.size() - 1), 0);
+            }
+
+            /** Stores the views under an id returned by `reserveId`. */
+            Slot& insert (ViewId id, std::unique_ptr<View> view, std::unique_ptr<ShadowView> shadowView)
+            {
+                const auto index = getIndex(id);
+
+                if (index >= slots.size())
+                    slots.resize(index + 1);
+
+                auto& slot = slots[index];
+
+                // If you hit this, the id was never reserved or has been used twice
+                jassert(slot.id < 0);
+
+                slot.id = id;
+                slot.view = std::move(view);
+                slot.shadowView = std::move(shadowView);
+
+                return slot;
+            }
+
+            /** Returns the slot holding the given id, or nullptr if there is none. */
+            Slot* find (ViewId id)
+            {
+                const auto index = getIndex(id);
+
+                if (id >= 0 && index < slots.size() && slots[index].id == id)
+                    return &slots[index];
+
+                return nullptr;
+            }
+
+            /** Destroys the views held under the given id and frees their slot. */
+            void erase (ViewId id)
+            {
+                if (auto* slot = find(id))
+                {
+                    destroy(*slot);
+
+                    const juce::SpinLock::ScopedLockType sl (allocationLock);
+                    retire(getIndex(id));
+                }
+            }
+
+            /** Destroys every view but those held under the given id, and retires every
+             *  other id handed out so far, including ids reserved for views which were
+             *  never inserted.
+             */
+            void clearAllExcept (ViewId idToKeep)
+            {
+                const auto indexToKeep = getIndex(idToKeep);
+
+                for (auto& slot : slots)
+                    if (slot.id >= 0 && slot.id != idToKeep)
+                        destroy(slot);
+
+                const juce::SpinLock::ScopedLockType sl (allocationLock);
+                freeIndices.clear();
+
+                // Pushed in reverse so that the lowest indices are handed out first
+                for (auto index = static_cast<juce::uint32>(generations.size()); index-- > 0;)
+                    if (index != indexToKeep)
+                        retire(index);
+            }
+
+            /** Calls the given function with each occupied slot. */
+            template <typename Callback>
+            void forEach (Callback&& callback)
+            {
+                for (auto& slot : slots)
+                    if (slot.id >= 0)
+                        callback(slot);
+            }
+
+        private:
+            //==============================================================================
+            static constexpr juce::uint32 generationMask = (1u << (31 - numIndexBits)) - 1;
+
+            static juce::uint32 getIndex (ViewId id)
+            {
+                return static_cast<juce::uint32>(id) & (maxNumSlots - 1);
+            }
+
+            static ViewId makeId (juce::uint32 index, juce::uint32 generation)
+            {
+                return static_cast<ViewId>((generation << numIndexBits) | index);
+            }
+
+            static void destroy (Slot& slot)
+            {
+                slot.id = -1;
+                slot.view.reset();
+                slot.shadowView.reset();
+                slot.pool = nullptr;
+            }
+
+            /** Bumps the generation of a free slot and returns it to the free list.
+             *  The allocation lock must be held.
+             */
+            void retire (juce::uint32 index)
+            {
+                generations[index] = (generations[index] + 1) & generationMask;
+                freeIndices.push_back(index);
+            }
+
+            //==============================================================================
+            std::vector<Slot> slots;
+
+            juce::SpinLock            allocationLock;
+            std::vector<juce::uint32> generations;
+            std::vector<juce::uint32> freeIndices;
+        };
+    }
+
+}
@@ -0,0 +1,129 @@
+/*
+  ==============================================================================
+
+    ViewTeardownQueue.h
+    Created: 16 Oct 2026 10:30:00pm
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "View.h"
+#include "ShadowView.h"
+
+
+namespace reactjuce
+{
+
+    namespace detail
+    {
+        //==============================================================================
+        /** Views removed from the tree, held until a gap on the message loop in which
+         *  to destroy them.
+         *
+         *  Destroying a large subtree inside a commit stalls the commit, so removed
+         *  views are queued instead and destroyed in slices of bounded duration, one
+         *  per gap, in the order they were queued. Views are queued children first,
+         *  so each is destroyed after its descendants.
+         */
+        class ViewTeardownQueue : private juce::AsyncUpdater
+        {
+        public:
+            using ViewPair = std::pair<std::unique_ptr<View>, std::unique_ptr<ShadowView>>;
+
+            struct Stats
+            {
+                size_t queueDepth = 0;
+                size_t peakQueueDepth = 0;
+                size_t numDestroyed = 0;
+                double lastSliceMs = 0.0;
+                double longestSliceMs = 0.0;
+                double totalDrainMs = 0.0;
+            };
+
+            ViewTeardownQueue() = default;
+
+            ~ViewTeardownQueue() override
+            {
+                cancelPendingUpdate();
+            }
+
+            //==============================================================================
+            /** Queues a pair of views, already removed from the tree, for destruction. */
+            void push (ViewPair pair)
+            {
+                queue.push_back(std::move(pair));
+                stats.peakQueueDepth = juce::jmax(stats.peakQueueDepth, queue.size());
+
+                triggerAsyncUpdate();
+            }
+
+            /** Sets the longest a single slice may spend destroying views. */
+            void setSliceBudget (double budgetMs)
+            {
+                sliceBudgetMs = juce::jmax(0.0, budgetMs);
+            }
+
+            /** Destroys everything in the queue at once. */
+            void flush()
+            {
+                cancelPendingUpdate();
+                drain(std::numeric_limits<double>::max());
+            }
+
+            Stats getStats() const
+            {
+                auto s = stats;
+                s.queueDepth = queue.size();
+                return s;
+            }
+
+        private:
+            //==============================================================================
+            void handleAsyncUpdate() override
+            {
+                drain(sliceBudgetMs);
+
+                if (!queue.empty())
+                    triggerAsyncUpdate();
+            }
+
+            void drain (double budgetMs)
+            {
+                const auto start = juce::Time::getMillisecondCounterHiRes();
+                auto elapsed = 0.0;
+
+                // Always destroys at least one pair, so that the queue drains however
+                // small the budget
+                while (!queue.empty())
+                {
+                    auto pair = std::move(queue.front());
+                    queue.pop_front();
+
+                    pair.first.reset();
+                    pair.second.reset();
+                    ++stats.numDestroyed;
+
+                    elapsed = juce::Time::getMillisecondCounterHiRes() - start;
+
+                    if (elapsed >= budgetMs)
+                        break;
+                }
+
+                stats.lastSliceMs = elapsed;
+                stats.longestSliceMs = juce::jmax(stats.longestSliceMs, elapsed);
+                stats.totalDrainMs += elapsed;
+            }
+
+            //==============================================================================
+            std::deque<ViewPair> queue;
+            double sliceBudgetMs = 2.0;
+            Stats stats;
+
+            //==============================================================================
+            JUCE_DECLARE_NON_COPYABLE (ViewTeardownQueue)
+        };
+    }
+
+}
@@ -3750,4 +3750,12 @@ typedef struct duk_hthread duk_context;
 
 #endif
 
+#if defined(REACTJUCE_DUKTAPE_INTERRUPT_HOOK)
+//NOTE: React-JUCE samples call stacks from the executor's periodic interrupt. The hook
+//      is only defined where the engine compiles Duktape, so that other users of this
+//      config, like the bytecode precompiler, are unaffected.
+#define DUK_USE_INTERRUPT_COUNTER
+#define DUK_USE_EXEC_TIMEOUT_CHECK(udata) REACTJUCE_DUKTAPE_INTERRUPT_HOOK(udata)
+#endif
+
 #endif  /* DUK_CONFIG_H_INCLUDED */
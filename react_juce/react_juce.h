@@ -38,6 +38,7 @@
 //==============================================================================
 #include "core/AppHarness.h"
 #include "core/EcmascriptEngine.h"
+#include "core/EngineThread.h"
 #include "core/CanvasView.h"
 
 #if JUCE_MODULE_AVAILABLE_juce_audio_processors
@@ -46,6 +47,7 @@
 
 #include "core/ImageView.h"
 #include "core/FileWatcher.h"
+#include "core/FrameClock.h"
 #include "core/RawTextView.h"
 #include "core/ReactApplicationRoot.h"
 #include "core/ScrollView.h"
@@ -0,0 +1,92 @@
+/*
+  ==============================================================================
+
+    DuktapePrecompiler.cpp
+    Created: 16 Oct 2026 10:12:00am
+
+    A small host tool which compiles a JavaScript bundle and writes the result
+    out with `duk_dump_function`, so that EcmascriptEngine::evaluateBytecode can
+    load it without parsing the bundle source at runtime.
+
+    Usage: reactjuce_duktape_precompiler <input.js> <output.dukbc>
+
+    The bundle is compiled exactly as EcmascriptEngine::evaluate compiles it,
+    in eval mode and with the bundle's file name, so error stack traces are
+    unchanged. Bytecode is specific to the Duktape version and configuration
+    it was dumped with, so this tool must be built against the same Duktape
+    sources as the plugin which loads its output.
+
+  ==============================================================================
+*/
+
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <string>
+
+#include <duktape/src-noline/duktape.c>
+
+
+namespace
+{
+    std::string getFileName (const std::string& path)
+    {
+        const auto pos = path.find_last_of("/\\");
+        return pos == std::string::npos ? path : path.substr(pos + 1);
+    }
+}
+
+int main (int argc, char* argv[])
+{
+    if (argc != 3)
+    {
+        std::fprintf(stderr, "Usage: %s <input.js> <output.dukbc>\n", argv[0]);
+        return 1;
+    }
+
+    std::ifstream input(argv[1], std::ios::binary);
+
+    if (!input)
+    {
+        std::fprintf(stderr, "Failed to open %s\n", argv[1]);
+        return 1;
+    }
+
+    const std::string source { std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>() };
+
+    duk_context* ctx = duk_create_heap_default();
+
+    if (ctx == nullptr)
+    {
+        std::fprintf(stderr, "Failed to create a Duktape heap\n");
+        return 1;
+    }
+
+    // Match the file name and compile flags used by EcmascriptEngine::evaluate
+    duk_push_string(ctx, getFileName(argv[1]).c_str());
+
+    if (duk_pcompile_lstring_filename(ctx, DUK_COMPILE_EVAL, source.data(), source.size()) != DUK_EXEC_SUCCESS)
+    {
+        std::fprintf(stderr, "%s\n", duk_safe_to_stacktrace(ctx, -1));
+        duk_destroy_heap(ctx);
+        return 1;
+    }
+
+    duk_dump_function(ctx);
+
+    duk_size_t size = 0;
+    const auto* data = static_cast<const char*>(duk_get_buffer(ctx, -1, &size));
+
+    std::ofstream output(argv[2], std::ios::binary | std::ios::trunc);
+    output.write(data, static_cast<std::streamsize>(size));
+
+    duk_destroy_heap(ctx);
+
+    if (!output)
+    {
+        std::fprintf(stderr, "Failed to write %s\n", argv[2]);
+        return 1;
+    }
+
+    return 0;
+}